@@ -9,9 +9,16 @@
 // updated date 2017/04/27, NTSC scan line number correction function addition
 // Fixed the selection date of 2017/04/30, SPI 1, SPI 2 update possible
 // Updated date 2017/06/25, fixed external VRAM can be specified
+// Updated date 2026/10/18, timer paced DMA to GPIO output (SC_GPIO modes) added
+// Updated date 2026/10/18, 16 bit SPI / DMA transfer (SC_DMA16 flag) added
+// Updated date 2026/10/18, video pipeline statistics (getStats, printStats) added
+// Updated date 2026/10/18, DMA start by timer 3, idle mode (WFI / sleep on exit) added
+// Updated date 2026/10/18, asynchronous VRAM fill / move by memory to memory DMA added
 
 #include"TNTSC.h"
 #include<SPI.h>
+#include <libmaple/scb.h>
+#include <libmaple/nvic.h>
 #define  gpio_write ( pin, val ) gpio_write_bit (PIN_MAP [pin] .gpio_device, PIN_MAP [pin] .gpio_bit, val)
 #define  PWM_CLK PA1            // Sync signal output pin (PWM)
 #define  DAT PA7                // Video signal output pin
@@ -19,11 +26,25 @@
 #define  NTSC_S_END  5          // vertical synchronization end line
 #define  NTSC_VTOP   30          // video display start line
 #define  IRQ_PRIORITY   2       // timer interrupt priority
+#define  NTSC_DMA_DELAY 8       // DMA start delay after the H sync (us, timer 3)
 #define  MYSPI1_DMA_CH DMA_CH3  // DMA channel for SPI 1
 #define  MYSPI2_DMA_CH DMA_CH5  // DMA channel for SPI 2
 #define  MYSPI_DMA DMA1         // DMA for SPI
 #define  Vsync_Pin       PA3       // interrupt from V sync
 #define  Hsync_Pin       PA2       // interrupt from H sync
+#define  GPIO_DAC_PORT   GPIOB     // GPIO port of the resistor DAC (SC_GPIO modes)
+#define  GPIO_DAC_PIN    12        // lowest DAC bit (PB12..PB14)
+#define  GPIO_DAC_BITS   3         // number of DAC bits
+#define  GPIO_DAC_MASK   (((1<<GPIO_DAC_BITS)-1) << GPIO_DAC_PIN)
+#define  GPIO_DMA_CH     DMA_CH2   // DMA channel for timer 2 update (TIM2_UP)
+#define  GPIO_DMA_IRQ    NVIC_DMA_CH2 // line expansion (pended by line_start, no DMA interrupt)
+#define  GPIO_PRIORITY   (IRQ_PRIORITY+1) // line expansion interrupt priority
+#define  VOP_DMA_CH      DMA_CH6   // DMA channel for VRAM operations (memory to memory)
+#define  VOP_DMA_IRQ     NVIC_DMA_CH6
+#define  DEMCR      (*(volatile uint32_t *)0xE000EDFC) // debug exception and monitor control
+#define  DWT_CTRL   (*(volatile uint32_t *)0xE0001000) // DWT control
+#define  DWT_CYCCNT (*(volatile uint32_t *)0xE0001004) // DWT cycle counter
+#define  CYCLES_US  (F_CPU / 1000000L)                 // CPU cycles per microsecond
    
 // Parameter setting by screen resolution
 typedef  struct   {
@@ -60,6 +81,40 @@ const SCREEN_SETUP screen_type[] __FLASH__{
 	{ 512, 216, 216, 64, 0,  SPI_CLOCK_DIV4 },  // 512X216
 };
 #endif
+#define  SCREEN_TYPES  (sizeof(screen_type)/sizeof(screen_type[0]))
+
+// Parameter setting by screen resolution (GPIO output)
+// One timer 2 update event moves one dot (a BSRR word) to the DAC port,
+// so the dot clock is F_CPU / period. About 8 MHz is the practical DMA limit.
+typedef  struct   {
+	uint16_t width;    // number of horizontal dots on screen
+	uint16_t height;   // screen vertical dot number
+	uint16_t ntscH;    // NTSC screen vertical dot number
+	uint16_t hsize;    // Number of horizontal bytes
+	uint8_t  flgHalf;  // vertical scanning line number (0: Normal 1: half)
+	uint8_t  bpp;      // bits per dot (1: black/white 2: 4 gray levels)
+	uint16_t period;   // timer clocks per dot
+} GPIO_SETUP;
+
+# if F_CPU == 72000000L
+const GPIO_SETUP gpio_type[] __FLASH__{
+ //width height ntscH  hsize flgHalf bpp period
+	{ 360, 108, 216, 45, 1, 1, 10 }, // 360X108 7.2MHz
+	{ 360, 216, 216, 45, 0, 1, 10 }, // 360X216 7.2MHz
+	{ 400, 108, 216, 50, 1, 1,  9 }, // 400X108 8MHz
+	{ 400, 216, 216, 50, 0, 1,  9 }, // 400X216 8MHz
+	{ 200, 216, 216, 50, 0, 2, 18 }, // 200X216 4MHz 4 gray levels
+};
+#elif   F_CPU == 48000000L
+const GPIO_SETUP gpio_type[] __FLASH__{
+	{ 336,  96, 192, 42, 1, 1,  7 }, // 336X96  6.86MHz
+	{ 336, 192, 192, 42, 0, 1,  7 }, // 336X192 6.86MHz
+	{ 400,  96, 192, 50, 1, 1,  6 }, // 400X96  8MHz
+	{ 400, 192, 192, 50, 0, 1,  6 }, // 400X192 8MHz
+	{ 200, 192, 192, 50, 0, 2, 12 }, // 200X192 4MHz 4 gray levels
+};
+#endif
+#define  GPIO_TYPES  (sizeof(gpio_type)/sizeof(gpio_type[0]))
 #define  NTSC_LINE (262+0)                       // Screen configuration Number of scanning lines (added to 2 for some monitors)
 #define  SYNC(V)  gpio_write(PWM_CLK, V)         // synchronous signal output (PWM)
 static  uint8_t* vram;                           // video display frame buffer
@@ -74,6 +129,34 @@ static uint16_t _width;
 static uint16_t _height;
 static uint16_t _ntscHeight;
 static uint16_t _vram_size;
+static uint16_t _hsize;                          // number of horizontal bytes
+static uint16_t _stride;                         // number of VRAM bytes per line
+static uint8_t  _dma16 = 0;                      // SPI / DMA transfer size (0: 8 bit 1: 16 bit)
+static uint8_t  _flgHalf;                        // vertical scanning line number (0: Normal 1: half)
+static uint8_t  _bpp = 1;                        // bits per dot
+static uint8_t  _gpio = 0;                       // output (0: SPI 1: GPIO)
+static uint32_t* _gbuf;                          // GPIO line buffers (2 lines of BSRR words)
+static uint32_t* _gline;                         // GPIO line buffer of the next line
+static const uint8_t* _gsrc;                     // VRAM line to expand into _gline
+static uint32_t _level[4];                       // BSRR word of each gray level
+static NTSC_STAT _st;                            // video pipeline statistics
+static NTSC_STAT _stSnap;                        // statistics copied at V sync for getStats()
+static volatile uint8_t _stReq = 0;              // request of a statistics copy
+static uint32_t _tLine;                          // H sync interrupt time of the last active line
+static uint32_t _tVsync;                         // V sync interrupt time
+static uint16_t _fieldLines;                     // H sync count of the current field
+static volatile uint16_t _line;                  // display line started by timer 3
+static volatile uint16_t _frames = 0;            // number of frames displayed
+static uint16_t _wakeFrame;                      // frame number to wake up at (IDLE_SLEEPONEXIT)
+static volatile uint8_t _wakeArmed = 0;          // wake up requested
+static uint8_t  _idleMode = IDLE_SPIN;           // idle mode of the wait functions
+static uint32_t _idleUs = 0;                     // time spent in the wait functions
+static VRAM_OP  _vq[NTSC_VOP_QUEUE];             // VRAM operation queue
+static volatile uint8_t _vqHead = 0;             // operation running or next (DMA interrupt)
+static volatile uint8_t _vqTail = 0;             // free entry (application)
+static volatile uint8_t _vopRun = 0;             // DMA of the head operation running
+static uint16_t _vopN;                           // transfers of the running DMA
+static volatile uint8_t _vblank = 0;             // in the vertical blanking period
 static uint16_t _ntsc_line = NTSC_LINE;
 static uint16_t _ntsc_adjust =0;
 static uint8_t  _spino = 1;
@@ -84,6 +167,9 @@ uint16_t TNTSC_class::width()  {return _width;;} ;
 uint16_t TNTSC_class::height() {return _height;} ;
 uint16_t TNTSC_class::vram_size() { return _vram_size;};
 uint16_t TNTSC_class::screen() { return _screen;};
+uint8_t  TNTSC_class::bpp() { return _bpp;};
+uint16_t TNTSC_class::stride() { return _stride;};
+uint8_t  TNTSC_class::byteSwap() { return _dma16;};
 // Blanking period start hook setting
 void TNTSC_class::setBktmStartHook(void (*func)()) {
   _bktmStartHook = func;
@@ -99,31 +185,109 @@ void TNTSC_class::DMA1_CH3_handle() {
 }
 
 // Data output using DMA
+// In the 16 bit mode one transfer sends a half word (upper byte first), so
+// the number of transfers is half of the length in bytes.
 void TNTSC_class::SPI_dmaSend(uint8_t *transmitBuf, uint16_t length) {
+  dma_xfer_size size = _dma16 ? DMA_SIZE_16BITS : DMA_SIZE_8BITS;
   dma_setup_transfer( 
     _spi_dma, _spi_dma_ch,  // DMA channel specification for SPI 1  
     &pSPI->dev()->regs->DR, // destination address: specify the SPI data register
-	DMA_SIZE_8BITS,			// Destination data size : 1 byte
+	size,			// Destination data size : 1 byte (2 bytes for 16 bit mode)
     transmitBuf,            // source address: SRAM address
-    DMA_SIZE_8BITS,         // Destination data size: 1 byte
+    size,                   // Destination data size: 1 byte (2 bytes for 16 bit mode)
     DMA_MINC_MODE|          // flag: cyclic
     DMA_FROM_MEM |          // Peripheral from memory, transfer complete interrupted
     DMA_TRNS_CMPLT          // Transfer complete Interrupted calling 
   );
+  if (_dma16)
+    length = (length + 1) >> 1;
   dma_set_num_transfers(_spi_dma, _spi_dma_ch, length);  // transfer size specification
   dma_enable(_spi_dma, _spi_dma_ch);  // DMA???
 }
 
+// Data output to GPIO using DMA paced by the timer 2 update event
+void TNTSC_class::GPIO_dmaSend(uint32_t *transmitBuf, uint16_t length) {
+  timer_pause(TIMER2);
+  timer_set_count(TIMER2, 0);          // start every line with the same dot phase
+  dma_setup_transfer(
+    DMA1, GPIO_DMA_CH,                 // DMA channel specification for TIM2_UP
+    &GPIO_DAC_PORT->regs->BSRR,        // destination address: GPIO bit set/reset register
+    DMA_SIZE_32BITS,                   // Destination data size: 4 bytes
+    transmitBuf,                       // source address: line buffer
+    DMA_SIZE_32BITS,                   // Source data size: 4 bytes
+    DMA_MINC_MODE|                     // flag: memory increment
+    DMA_FROM_MEM                       // Peripheral from memory
+  );
+  dma_set_num_transfers(DMA1, GPIO_DMA_CH, length);
+  dma_enable(DMA1, GPIO_DMA_CH);
+  timer_resume(TIMER2);
+}
+
+// Convert one VRAM line to BSRR words (the last word returns to black)
+void TNTSC_class::GPIO_expand(uint32_t *dst, const uint8_t *src) {
+  const uint32_t* lv = _level;
+  uint16_t n = _hsize;
+  uint8_t d;
+  if (_bpp == 1) {
+    while (n--) {
+      d = *src++;
+      dst[0] = lv[d>>7];     dst[1] = lv[(d>>6)&1];
+      dst[2] = lv[(d>>5)&1]; dst[3] = lv[(d>>4)&1];
+      dst[4] = lv[(d>>3)&1]; dst[5] = lv[(d>>2)&1];
+      dst[6] = lv[(d>>1)&1]; dst[7] = lv[d&1];
+      dst += 8;
+    }
+  } else {
+    while (n--) {
+      d = *src++;
+      dst[0] = lv[d>>6];     dst[1] = lv[(d>>4)&3];
+      dst[2] = lv[(d>>2)&3]; dst[3] = lv[d&3];
+      dst += 4;
+    }
+  }
+  *dst = (uint32_t)GPIO_DAC_MASK << 16;
+}
+
+// Expansion of the next line (GPIO DMA channel interrupt pended by line_start)
+// It runs below the sync and line start interrupts while the other buffer is output.
+void TNTSC_class::GPIO_handle() {
+  GPIO_expand(_gline, _gsrc);
+}
+// Run the line expansion interrupt
+void TNTSC_class::GPIO_kick(const uint8_t *src) {
+  _gsrc = src;
+  NVIC_BASE->ISPR[GPIO_DMA_IRQ / 32] = BIT(GPIO_DMA_IRQ % 32);
+}
+
 // Data display for video (raster output)
+// The H sync interrupt only arms timer 3, the DMA is started by its update
+// interrupt NTSC_DMA_DELAY us later, so no time is spent waiting in the interrupt.
 void TNTSC_class::handle_vout() {
-  delayMicroseconds(8);                                                 //delay 8us after the H sync
+  uint32_t t = DWT_CYCCNT;                                              // H sync interrupt time
+  _fieldLines++;
   if (count >= NTSC_VTOP && count <= _ntscHeight+NTSC_VTOP-1) {  	     // >=30  <= 216+50-1
-    SPI_dmaSend((uint8_t *)ptr, screen_type[_screen].hsize);
-  	if (screen_type[_screen].flgHalf) {
-      if ((count-NTSC_VTOP) & 1) 
-      ptr+= screen_type[_screen].hsize;
-    } else {
-      ptr+=screen_type[_screen].hsize;
+    if (count > NTSC_VTOP) {
+      // Line interval and DMA of the previous line still running
+      uint32_t d = t - _tLine;
+      if (d < _st.hsyncMin) _st.hsyncMin = d;
+      if (d > _st.hsyncMax) _st.hsyncMax = d;
+      if (dma_get_count(_gpio ? DMA1 : _spi_dma, _gpio ? GPIO_DMA_CH : _spi_dma_ch))
+        _st.dmaBusy++;
+    }
+    _tLine = t;
+    _line = count - NTSC_VTOP;
+    if (count == NTSC_VTOP)
+      _vblank = 0;
+    TIMER3->regs.gen->CR1 |= TIMER_CR1_CEN;                             // one pulse: DMA start after 8us
+  } else if (count == _ntscHeight+NTSC_VTOP) {
+    // End of the display period
+    _frames++;
+    _vblank = 1;
+    if (_vqHead != _vqTail)
+      vop_kick();                                                       // VOP_BLANK operations waiting
+    if (_wakeArmed && _frames == _wakeFrame) {
+      _wakeArmed = 0;
+      SCB_BASE->SCR &= ~SCB_SCR_SLEEPONEXIT;                            // return to the application
     }
   }
 	// Sync pulse width setting for the next scanning line
@@ -135,30 +299,285 @@ void TNTSC_class::handle_vout() {
     TIMER2->regs.adv->CCR2 = 112;
   }*/
    count++; 
-  Serial.println(count);
+}
+// DMA start of a display line (timer 3 update interrupt)
+void TNTSC_class::line_start() {
+  uint32_t t;
+  if (_gpio)
+    GPIO_dmaSend(_gline, _width+1);
+  else
+    SPI_dmaSend((uint8_t *)ptr, _hsize);
+  t = DWT_CYCCNT - _tLine;                                              // H sync to DMA start
+  if (t > _st.latencyMax) _st.latencyMax = t;
+  t /= CYCLES_US;
+  _st.latency[t < NTSC_LATENCY_BINS ? t : NTSC_LATENCY_BINS-1]++;
+  if (!_flgHalf || (_line & 1)) {
+    ptr += _stride;
+    if (_gpio && _line < _ntscHeight-1) {
+      // The next line is prepared in the other buffer while this one is output
+      _gline = (_gline == _gbuf) ? _gbuf + _width+1 : _gbuf;
+      GPIO_kick((const uint8_t *)ptr);
+    }
+  }
 }
 void TNTSC_class::vSync_reset() {
+  uint32_t t = DWT_CYCCNT;
+  if (_st.fields) {
+    // Field interval and number of lines (262 and 263 lines alternate)
+    uint32_t d = t - _tVsync;
+    _st.vsync = d;
+    if (d < _st.vsyncMin) _st.vsyncMin = d;
+    if (d > _st.vsyncMax) _st.vsyncMax = d;
+    _st.lines = _fieldLines;
+    if (_fieldLines < _st.linesMin) _st.linesMin = _fieldLines;
+    if (_fieldLines > _st.linesMax) _st.linesMax = _fieldLines;
+    if (_fieldLines + 1 < _ntsc_line || _fieldLines > _ntsc_line + 1)
+      _st.badFields++;
+  }
+  _st.fields++;
+  _tVsync = t;
+  _fieldLines = 0;
+  if (_stReq) {
+    _stSnap = _st;
+    _stReq = 0;
+  }
   if( count > _ntsc_line ){
     count=1;
     ptr = vram;    
+    if (_gpio)
+      GPIO_kick(vram);
   } 
   
 }
+// Run the VRAM operation interrupt (starts queued operations)
+void TNTSC_class::vop_kick() {
+  NVIC_BASE->ISPR[VOP_DMA_IRQ / 32] = BIT(VOP_DMA_IRQ % 32);
+}
+// Start the next transfer of a VRAM operation
+// A move to a higher address is done backwards in pieces that do not overlap.
+void TNTSC_class::vop_start(VRAM_OP* op) {
+  uint16_t n = op->count < op->chunk ? op->count : op->chunk;
+  uint32_t off = (uint32_t)(op->count - n) << op->size;
+  dma_setup_transfer(
+    DMA1, VOP_DMA_CH,
+    op->dst + off,                           // destination address (peripheral side)
+    (dma_xfer_size)op->size,
+    op->src ? (uint8_t *)op->src + off : (uint8_t *)&op->pat, // source address
+    (dma_xfer_size)op->size,
+    DMA_MEM_2_MEM | DMA_FROM_MEM | DMA_PINC_MODE |
+    (op->src ? DMA_MINC_MODE : 0) | DMA_TRNS_CMPLT
+  );
+  dma_set_priority(DMA1, VOP_DMA_CH, DMA_PRIORITY_LOW);
+  dma_set_num_transfers(DMA1, VOP_DMA_CH, n);
+  _vopN = n;
+  dma_enable(DMA1, VOP_DMA_CH);
+}
+// VRAM operation interrupt (transfer complete or vop_kick())
+void TNTSC_class::vop_handle() {
+  VRAM_OP* op;
+  void (*done)();
+  if (_vopRun) {
+    if (dma_get_count(DMA1, VOP_DMA_CH))
+      return;                                // kicked while the transfer runs
+    op = &_vq[_vqHead];
+    op->count -= _vopN;
+    if (op->count) {
+      vop_start(op);
+      return;
+    }
+    dma_disable(DMA1, VOP_DMA_CH);
+    _vopRun = 0;
+    done = op->done;
+    _vqHead = (_vqHead + 1) % NTSC_VOP_QUEUE;
+    if (done)
+      done();
+  }
+  while (_vqHead != _vqTail) {
+    op = &_vq[_vqHead];
+    if ((op->flags & VOP_BLANK) && !_vblank)
+      return;                                // started at the end of the display period
+    if (op->head)
+      memset(op->dst - op->head, op->pat, op->head);
+    if (op->tail)
+      memset(op->dst + ((uint32_t)op->count << 2), op->pat, op->tail);
+    if (op->count) {
+      _vopRun = 1;
+      vop_start(op);
+      return;
+    }
+    done = op->done;
+    _vqHead = (_vqHead + 1) % NTSC_VOP_QUEUE;
+    if (done)
+      done();
+  }
+}
+// Queue a VRAM operation (src NULL: fill n bytes with pat)
+// Single producer: only the application queues, done() callbacks must not.
+bool TNTSC_class::vop_push(uint8_t* dst, const uint8_t* src, uint16_t n, uint8_t pat, void (*done)(), uint8_t flags) {
+  uint8_t t = _vqTail;
+  uint8_t next = (t + 1) % NTSC_VOP_QUEUE;
+  VRAM_OP* op = &_vq[t];
+  if (next == _vqHead)
+    return false;                            // queue full
+  op->src = src;
+  op->pat = pat * 0x01010101UL;
+  op->head = op->tail = 0;
+  op->flags = flags;
+  op->done = done;
+  if (!src) {
+    // Bytes up to a word boundary and after the last word are done by the CPU
+    op->head = (0 - (uintptr_t)dst) & 3;
+    if (op->head > n)
+      op->head = n;
+    dst += op->head;
+    n -= op->head;
+    op->tail = n & 3;
+    op->size = 2;
+  } else if (((uintptr_t)dst | (uintptr_t)src | n) & 1) {
+    op->size = 0;
+  } else {
+    op->size = (((uintptr_t)dst | (uintptr_t)src | n) & 2) ? 1 : 2;
+  }
+  op->dst = dst;
+  op->count = n >> op->size;
+  op->chunk = op->count;
+  if (src && dst > src && dst < src + n)
+    op->chunk = (dst - src) >> op->size;
+  asm volatile ("" ::: "memory");            // the entry is written before it is queued
+  _vqTail = next;
+  vop_kick();
+  return true;
+}
+// Fill VRAM lines with a byte pattern by DMA (false: queue full)
+// The operations are done in order, done() is called from the DMA interrupt at the end.
+// done() must not queue operations or wait for them (asyncWait()).
+// flags VOP_BLANK: start in the vertical blanking period (no tearing for short operations)
+bool TNTSC_class::fillAsync(uint16_t y, uint16_t lines, uint8_t pat, void (*done)(), uint8_t flags) {
+  if (y >= _height)
+    lines = 0;
+  else if (y + lines > _height)
+    lines = _height - y;
+  return vop_push(vram + y*_stride, NULL, lines*_stride, pat, done, flags);
+}
+// Move VRAM lines sy..sy+lines-1 to dy.. by DMA (false: queue full)
+bool TNTSC_class::moveAsync(uint16_t dy, uint16_t sy, uint16_t lines, void (*done)(), uint8_t flags) {
+  uint16_t y = dy > sy ? dy : sy;
+  if (y >= _height)
+    lines = 0;
+  else if (y + lines > _height)
+    lines = _height - y;
+  return vop_push(vram + dy*_stride, vram + sy*_stride, lines*_stride, 0, done, flags);
+}
+// Free entries of the VRAM operation queue
+uint8_t TNTSC_class::asyncFree() {
+  return (_vqHead + NTSC_VOP_QUEUE - 1 - _vqTail) % NTSC_VOP_QUEUE;
+}
+// VRAM operations queued or running
+bool TNTSC_class::asyncBusy() {
+  return _vqHead != _vqTail;
+}
+// Wait for the end of the queued VRAM operations
+void TNTSC_class::asyncWait() {
+  uint32_t start = micros();
+  while (_vqHead != _vqTail) {
+    if (_idleMode != IDLE_SPIN)
+      asm volatile ("wfi");
+  }
+  _idleUs += micros() - start;
+}
 void  TNTSC_class::adjust(int16_t cnt) {
 	_ntsc_adjust = cnt;
 	_ntsc_line = NTSC_LINE + cnt;
 }
+// DAC code of a gray level (index 0,1 for black/white modes, 0..3 for 4 gray level modes)
+void  TNTSC_class::setLevel(uint8_t index, uint8_t code) {
+	if (index > 3)
+		return;
+	code &= (1 << GPIO_DAC_BITS) - 1;
+	_level[index] = ((uint32_t)code << GPIO_DAC_PIN)
+		| ((uint32_t)(~code & ((1 << GPIO_DAC_BITS) - 1)) << (GPIO_DAC_PIN + 16));
+}
+// Clear the video pipeline statistics
+void  TNTSC_class::clearStats() {
+	memset(&_st, 0, sizeof(_st));
+	_st.linesMin = 0xffff;
+	_st.vsyncMin = 0xffffffff;
+	_st.hsyncMin = 0xffffffff;
+}
+// Get the video pipeline statistics
+// The copy is made by the V sync interrupt, so it is consistent and interrupts are
+// never disabled (waits for up to one field).
+void  TNTSC_class::getStats(NTSC_STAT * st) {
+	uint32_t start = millis();
+	_stReq = 1;
+	while (_stReq && millis() - start < 100);
+	if (_stReq) {
+		_stReq = 0;                 // no V sync: copy as it is
+		memcpy(st, &_st, sizeof(NTSC_STAT));
+	} else {
+		memcpy(st, &_stSnap, sizeof(NTSC_STAT));
+	}
+}
+// Dump the video pipeline statistics (times in microseconds)
+void  TNTSC_class::printStats(Print & out) {
+	NTSC_STAT st;
+	getStats(&st);
+	out.print("fields: ");     out.print(st.fields);
+	out.print(" bad: ");       out.println(st.badFields);
+	out.print("lines: ");      out.print(st.lines);
+	out.print(" min: ");       out.print(st.linesMin);
+	out.print(" max: ");       out.println(st.linesMax);
+	out.print("vsync: ");      out.print(st.vsync / CYCLES_US);
+	out.print(" min: ");       out.print(st.vsyncMin / CYCLES_US);
+	out.print(" max: ");       out.println(st.vsyncMax / CYCLES_US);
+	out.print("hsync min: ");  out.print(st.hsyncMin / CYCLES_US);
+	out.print(" max: ");       out.println(st.hsyncMax / CYCLES_US);
+	out.print("dma busy: ");   out.println(st.dmaBusy);
+	out.print("latency max: "); out.println(st.latencyMax / CYCLES_US);
+	for (uint8_t i = 0; i < NTSC_LATENCY_BINS; i++) {
+		out.print(i);
+		out.print(i == NTSC_LATENCY_BINS-1 ? "+us: " : "us: ");
+		out.println(st.latency[i]);
+	}
+}
 // Start NTSC video display
 // void TNTSC_class :: begin (uint8_t mode) {
 void  TNTSC_class::begin(uint8_t mode, uint8_t spino, uint8_t * extram) {
 	// Screen setting
   pinMode(Vsync_Pin, INPUT);
   pinMode(Hsync_Pin, INPUT);
-	_screen = mode <= 4 ? mode : SC_DEFAULT;
-	_width = screen_type[_screen].width;
-	_height = screen_type[_screen].height;
-	_vram_size = screen_type[_screen].hsize * _height;
-	_ntscHeight = screen_type[_screen].ntscH;
+	_gpio = (mode & SC_GPIO) ? 1 : 0;
+	if (_gpio) {
+		uint8_t no = mode & ~(SC_GPIO|SC_DMA16);
+		if (no >= GPIO_TYPES) no = 0;
+		_screen = SC_GPIO | no;
+		_width = gpio_type[no].width;
+		_height = gpio_type[no].height;
+		_hsize = gpio_type[no].hsize;
+		_flgHalf = gpio_type[no].flgHalf;
+		_bpp = gpio_type[no].bpp;
+		_ntscHeight = gpio_type[no].ntscH;
+		// Line buffers (double buffered, one BSRR word per dot + black at the end)
+		_gbuf = (uint32_t *)malloc((_width + 1) * 2 * sizeof(uint32_t));
+		if (!_gbuf) {
+			_gpio = 0;           // no memory: SPI output in the default mode
+			mode = SC_DEFAULT;
+		}
+	}
+	if (!_gpio) {
+		_screen = mode & ~SC_DMA16;
+		if (_screen >= SCREEN_TYPES) _screen = SC_DEFAULT;
+		_width = screen_type[_screen].width;
+		_height = screen_type[_screen].height;
+		_hsize = screen_type[_screen].hsize;
+		_flgHalf = screen_type[_screen].flgHalf;
+		_bpp = 1;
+		_ntscHeight = screen_type[_screen].ntscH;
+	}
+	// 16 bit transfer: word aligned lines, bytes of each half word swapped in VRAM
+	_dma16 = (!_gpio && (mode & SC_DMA16)) ? 1 : 0;
+	_stride = _dma16 ? (_hsize + 3) & ~3 : _hsize;
+	_vram_size = _stride * _height;
 	_spino = spino;
 	flgExtVram = false;
 	if (extram) {
@@ -171,6 +590,55 @@ void  TNTSC_class::begin(uint8_t mode, uint8_t spino, uint8_t * extram) {
 	cls();
 	ptr = vram;   // Frame buffer reference pointer for video display
 	count = 1;
+	// Cycle counter for the statistics
+	DEMCR |= 1 << 24;       // TRCENA
+	DWT_CTRL |= 1;          // CYCCNTENA
+	clearStats();
+
+	// Timer 3 one pulse: update interrupt NTSC_DMA_DELAY us after it is started
+	Timer3.pause();
+	timer_set_prescaler(TIMER3, 0);
+	timer_set_reload(TIMER3, NTSC_DMA_DELAY * CYCLES_US - 1);
+	timer_set_count(TIMER3, 0);
+	TIMER3->regs.gen->CR1 |= TIMER_CR1_OPM | TIMER_CR1_URS;  // stop at the update, no interrupt by UG
+	timer_generate_update(TIMER3);                            // load the prescaler
+	timer_attach_interrupt(TIMER3, TIMER_UPDATE_INTERRUPT, line_start);
+
+	// VRAM operations: memory to memory DMA at low priority. A channel above the
+	// video channels also loses to them at the same priority.
+	dma_init(DMA1);
+	dma_attach_interrupt(DMA1, VOP_DMA_CH, vop_handle);
+	_vqHead = _vqTail = 0;
+	_vopRun = 0;
+	_vblank = 0;
+	if (_gpio) {
+		// Resistor DAC output, black level at start
+		for (uint8_t i = 0; i < GPIO_DAC_BITS; i++)
+			gpio_set_mode(GPIO_DAC_PORT, GPIO_DAC_PIN + i, GPIO_OUTPUT_PP);
+		GPIO_DAC_PORT->regs->BSRR = (uint32_t)GPIO_DAC_MASK << 16;
+		uint8_t levels = 1 << _bpp;
+		for (uint8_t i = 0; i < levels; i++)
+			setLevel(i, i * ((1 << GPIO_DAC_BITS) - 1) / (levels - 1));
+
+		_gline = _gbuf;
+		GPIO_expand(_gline, vram);
+
+		// DMA setting for GPIO data transfer, its interrupt expands the lines
+		dma_init(DMA1);
+		dma_set_priority(DMA1, GPIO_DMA_CH, DMA_PRIORITY_VERY_HIGH);
+		dma_attach_interrupt(DMA1, GPIO_DMA_CH, GPIO_handle);
+
+		// Timer 2 update event requests DMA, one dot per period
+		Timer2.pause();
+		timer_set_prescaler(TIMER2, 0);
+		timer_set_reload(TIMER2, gpio_type[_screen & ~SC_GPIO].period - 1);
+		TIMER2->regs.gen->DIER |= TIMER_DIER_UDE;
+
+		attachInterrupt(Vsync_Pin, vSync_reset,FALLING);
+		attachInterrupt(Hsync_Pin, handle_vout,FALLING);
+		set_priority();
+		return;
+	}
 	// SPI initialization / setting
 	if (spino == 2) {
 		pSPI = new  SPIClass(2);
@@ -192,6 +660,12 @@ void  TNTSC_class::begin(uint8_t mode, uint8_t spino, uint8_t * extram) {
 		pSPI->setClockDivider(screen_type[_screen].spiDiv);     // Set the clock to 1/16 of the system clock 72 MHz
 	}
 	pSPI->dev()->regs->CR1 |= SPI_CR1_BIDIMODE_1_LINE | SPI_CR1_BIDIOE; // Setting for sending only use
+	if (_dma16) {
+		// The data frame format can be changed only while SPI is disabled
+		pSPI->dev()->regs->CR1 &= ~SPI_CR1_SPE;
+		pSPI->dev()->regs->CR1 |= SPI_CR1_DFF;
+		pSPI->dev()->regs->CR1 |= SPI_CR1_SPE;
+	}
 
 	// DMA setting for SPI data transfer
 	dma_init(_spi_dma);
@@ -218,16 +692,49 @@ void  TNTSC_class::begin(uint8_t mode, uint8_t spino, uint8_t * extram) {
 	Timer2.resume();         // timer start  */
   attachInterrupt(Vsync_Pin, vSync_reset,FALLING);
   attachInterrupt(Hsync_Pin, handle_vout,FALLING);
+  set_priority();
+}
+
+// The sync, line start and line end interrupts preempt the line expansion
+// (GPIO modes) and the VRAM operation interrupts
+void  TNTSC_class::set_priority() {
+	nvic_irq_set_priority(NVIC_EXTI2, IRQ_PRIORITY);   // H sync (PA2)
+	nvic_irq_set_priority(NVIC_EXTI3, IRQ_PRIORITY);   // V sync (PA3)
+	nvic_irq_set_priority(NVIC_TIMER3, IRQ_PRIORITY);  // line DMA start
+	if (_gpio)
+		nvic_irq_set_priority(GPIO_DMA_IRQ, GPIO_PRIORITY); // line expansion (GPIO_handle)
+	else
+		nvic_irq_set_priority((nvic_irq_num)(NVIC_DMA_CH1 + _spi_dma_ch - DMA_CH1), IRQ_PRIORITY); // line DMA end (DMA1_CH3_handle)
+	nvic_irq_set_priority(VOP_DMA_IRQ, 0xf);           // lowest
 }
 
 // End of NTSC video display
 void  TNTSC_class::end() {
+	dma_disable(DMA1, VOP_DMA_CH);
+	dma_detach_interrupt(DMA1, VOP_DMA_CH);
+	_vqHead = _vqTail = 0;
+	_vopRun = 0;
 	Timer2.pause();
 	//Timer2.detachInterrupt(1);
    detachInterrupt(Hsync_Pin);
    detachInterrupt(Vsync_Pin);
+	Timer3.pause();
+	timer_detach_interrupt(TIMER3, TIMER_UPDATE_INTERRUPT);
+	TIMER3->regs.gen->CR1 &= ~(TIMER_CR1_OPM | TIMER_CR1_URS);
+	if (_gpio) {
+		TIMER2->regs.gen->DIER &= ~TIMER_DIER_UDE;
+		dma_disable(DMA1, GPIO_DMA_CH);
+		dma_detach_interrupt(DMA1, GPIO_DMA_CH);
+		GPIO_DAC_PORT->regs->BSRR = (uint32_t)GPIO_DAC_MASK << 16;
+		free(_gbuf);
+		if (!flgExtVram)
+			free(vram);
+		return;
+	}
 	spi_tx_dma_disable(pSPI->dev());
 	dma_detach_interrupt(_spi_dma, _spi_dma_ch);
+	pSPI->dev()->regs->CR1 &= ~SPI_CR1_SPE;
+	pSPI->dev()->regs->CR1 &= ~SPI_CR1_DFF;
 	pSPI->end();
 	if (!flgExtVram)
 		free(vram);
@@ -244,12 +751,43 @@ uint8_t * TNTSC_class::VRAM() {
 void  TNTSC_class::cls() {
 	memset(vram, 0, _vram_size);
 }
+// Idle mode of the wait functions
+//   IDLE_SPIN        : busy wait
+//   IDLE_WFI         : sleep until each interrupt (H sync, SysTick ...) and check again
+//   IDLE_SLEEPONEXIT : delay_frame() sleeps without returning to the application
+//                      between the interrupts, the end of the display period wakes it up
+void  TNTSC_class::setIdleMode(uint8_t mode) {
+	_idleMode = mode;
+}
+// Time spent in the wait functions (us)
+uint32_t TNTSC_class::idleTime() {
+	return _idleUs;
+}
 // Wait between frames
 void  TNTSC_class::delay_frame(uint16_t x) {
-	while (x) {
-		while (count!= _ntscHeight + NTSC_VTOP);
-		while (count == _ntscHeight + NTSC_VTOP);
-		x--;
+	uint32_t start = micros();
+	uint16_t frame = _frames + x;
+	if (_idleMode == IDLE_SLEEPONEXIT && x) {
+		_wakeFrame = frame;
+		_wakeArmed = 1;
+		SCB_BASE->SCR |= SCB_SCR_SLEEPONEXIT;
+	}
+	while ((int16_t)(frame - _frames) > 0) {
+		if (_idleMode != IDLE_SPIN)
+			asm volatile ("wfi");
+	}
+	_wakeArmed = 0;
+	SCB_BASE->SCR &= ~SCB_SCR_SLEEPONEXIT;
+	_idleUs += micros() - start;
+}
+// Wait (milliseconds)
+void  TNTSC_class::delay(uint32_t ms) {
+	uint32_t start = millis();
+	uint32_t us = micros();
+	while (millis() - start < ms) {
+		if (_idleMode != IDLE_SPIN)
+			asm volatile ("wfi");
 	}
+	_idleUs += micros() - us;
 }
 TNTSC_class TNTSC;
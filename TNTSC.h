@@ -8,6 +8,11 @@
 // updated date 2017/04/27, NTSC scanning line number correction function adjust () added
 // Fixed the selection date of 2017/04/30, SPI 1, SPI 2 update possible
 // Updated date 2017/06/25, fixed external VRAM can be specified
+// Updated date 2026/10/18, timer paced DMA to GPIO output (SC_GPIO modes) added
+// Updated date 2026/10/18, 16 bit SPI / DMA transfer (SC_DMA16 flag) added
+// Updated date 2026/10/18, video pipeline statistics (getStats, printStats) added
+// Updated date 2026/10/18, DMA start by timer 3, idle mode (WFI / sleep on exit) added
+// Updated date 2026/10/18, asynchronous VRAM fill / move (fillAsync, moveAsync) added
 //
 
 #ifndef __TNTSC_H__
@@ -15,6 +20,18 @@
 
 #include <Arduino.h>
 
+// SC_GPIO modes output dots through a 3 bit resistor DAC on PB12..PB14 with DMA paced by
+// timer 2 instead of SPI, which allows any dot clock of F_CPU / n.
+// In the 4 gray level modes each dot uses 2 bits of VRAM (MSB first).
+// Without memory for the line buffers begin() starts SC_DEFAULT (SPI) instead.
+#define  SC_GPIO      0x80  // mode flag: timer paced DMA to GPIO (resistor DAC) instead of SPI
+
+// SC_DMA16 sends VRAM as 16 bit SPI frames with half word DMA, which halves the bus
+// cycles taken from the drawing code during active video. Each VRAM line starts on a
+// word boundary (see stride()) and the two bytes of each half word are swapped in
+// memory (see byteSwap()), TTVout takes care of both. External VRAM must be word aligned.
+#define  SC_DMA16     0x40  // mode flag: 16 bit SPI / DMA transfer (SPI modes only)
+
 #if F_CPU == 72000000L
 #define  SC_112x108   0  // 112 x 108
 #define  SC_224x108   1  // 224 x 108
@@ -22,6 +39,11 @@
 #define  SC_448x108   3  // 448x108
 #define  SC_448x216   4  // 448 x 216
 #define  SC_DEFAULT   SC_224x216
+#define  SC_360x108G  (SC_GPIO|0)  // 360 x 108 GPIO output
+#define  SC_360x216G  (SC_GPIO|1)  // 360 x 216 GPIO output
+#define  SC_400x108G  (SC_GPIO|2)  // 400 x 108 GPIO output
+#define  SC_400x216G  (SC_GPIO|3)  // 400 x 216 GPIO output
+#define  SC_200x216G4 (SC_GPIO|4)  // 200 x 216 GPIO output, 4 gray levels (2 bits per dot)
 #elif F_CPU == 48000000L
 #define  SC_128x96    0  // 128 x 96
 #define  SC_256x96    1  // 256 x 96
@@ -34,8 +56,54 @@
 #define  SC_512x108   8  // 512 x 108
 #define  SC_512x216   9  // 512 x 216
 #define  SC_DEFAULT   SC_256x192
+#define  SC_336x96G   (SC_GPIO|0)  // 336 x 96 GPIO output
+#define  SC_336x192G  (SC_GPIO|1)  // 336 x 192 GPIO output
+#define  SC_400x96G   (SC_GPIO|2)  // 400 x 96 GPIO output
+#define  SC_400x192G  (SC_GPIO|3)  // 400 x 192 GPIO output
+#define  SC_200x192G4 (SC_GPIO|4)  // 200 x 192 GPIO output, 4 gray levels (2 bits per dot)
 #endif
 
+// Idle mode of delay_frame() and delay() (see setIdleMode())
+#define  IDLE_SPIN         0  // busy wait
+#define  IDLE_WFI          1  // sleep (WFI) between the interrupts
+#define  IDLE_SLEEPONEXIT  2  // delay_frame() stays asleep until the end of the display period
+
+// Asynchronous VRAM operations (see fillAsync(), moveAsync())
+#define  NTSC_VOP_QUEUE    4  // queue entries (up to 3 operations queued)
+#define  VOP_BLANK      0x01  // start in the vertical blanking period
+
+// Queued VRAM operation (internal)
+typedef struct {
+	uint8_t* dst;        // destination (fill: first whole word)
+	const uint8_t* src;  // source (NULL: fill with pat)
+	uint32_t pat;        // fill pattern
+	uint16_t count;      // number of transfers left
+	uint16_t chunk;      // transfers at a time (a move to a higher address goes backwards)
+	uint8_t  size;       // transfer size (0: 8 bit 1: 16 bit 2: 32 bit)
+	uint8_t  head;       // fill: bytes before dst done by the CPU
+	uint8_t  tail;       // fill: bytes after the words done by the CPU
+	uint8_t  flags;      // VOP_BLANK
+	void (*done)();      // completion callback
+} VRAM_OP;
+
+// Video pipeline statistics (times in CPU cycles, see TNTSC_class::getStats())
+#define  NTSC_LATENCY_BINS 16
+typedef struct {
+	uint32_t fields;      // number of fields (V sync)
+	uint32_t badFields;   // fields with a wrong number of lines
+	uint16_t lines;       // number of lines (H sync) of the last field
+	uint16_t linesMin;    // fewest lines of a field
+	uint16_t linesMax;    // most lines of a field
+	uint32_t vsync;       // last V sync interval
+	uint32_t vsyncMin;    // shortest V sync interval
+	uint32_t vsyncMax;    // longest V sync interval
+	uint32_t hsyncMin;    // shortest H sync interval in the display period
+	uint32_t hsyncMax;    // longest H sync interval in the display period
+	uint32_t dmaBusy;     // lines started while the DMA of the previous line was running
+	uint32_t latencyMax;  // longest time from H sync interrupt to DMA start
+	uint32_t latency[NTSC_LATENCY_BINS]; // H sync interrupt to DMA start histogram (1us bins)
+} NTSC_STAT;
+
 // ntsc Video display class definition
 class  TNTSC_class {
 private:
@@ -46,20 +114,45 @@ public:
 	uint8_t *   VRAM();                       // Get the VRAM address
 	void  cls();                              // clear screen
 	void  delay_frame(uint16_t x);           // Wait for frame conversion time
+	void  delay(uint32_t ms);                // Wait (milliseconds)
+	void  setIdleMode(uint8_t mode);         // Idle mode of the wait functions
+	uint32_t idleTime();                     // Time spent in the wait functions (us)
 	void  setBktmStartHook(void(*func) ());  // Blanking period start hook setting
 	void  setBktmEndHook(void(*func) ());    // Blanking period end hook setting
 	void  adjust(int16_t cnt);
+	void  getStats(NTSC_STAT * st);          // Get the video pipeline statistics
+	void  clearStats();                      // Clear the video pipeline statistics
+	void  printStats(Print & out);           // Dump the video pipeline statistics
+	void  setLevel(uint8_t index, uint8_t code); // DAC code of a gray level (SC_GPIO modes only)
+	bool  fillAsync(uint16_t y, uint16_t lines, uint8_t pat, void (*done)() = NULL, uint8_t flags = 0); // Fill VRAM lines by DMA
+	bool  moveAsync(uint16_t dy, uint16_t sy, uint16_t lines, void (*done)() = NULL, uint8_t flags = 0); // Move VRAM lines by DMA
+	uint8_t asyncFree();                     // Free entries of the VRAM operation queue
+	bool  asyncBusy();                       // VRAM operations queued or running
+	void  asyncWait();                       // Wait for the end of the VRAM operations
 
 	uint16_t  width();
 	uint16_t  height();
 	uint16_t  vram_size();
 	uint16_t  screen();
+	uint8_t   bpp();                          // bits per dot in VRAM (1 or 2)
+	uint16_t  stride();                       // number of VRAM bytes per line
+	uint8_t   byteSwap();                     // bytes of each VRAM half word swapped (1: SC_DMA16)
 
 private:
 	static  void  handle_vout();
+	static  void  line_start();
   static  void  vSync_reset();
  	static  void  SPI_dmaSend(uint8_t * transmitBuf, uint16_t length);
 	static  void  DMA1_CH3_handle();
+	static  void  GPIO_dmaSend(uint32_t * transmitBuf, uint16_t length);
+	static  void  GPIO_expand(uint32_t * dst, const uint8_t * src);
+	static  void  GPIO_handle();
+	static  void  GPIO_kick(const uint8_t * src);
+	static  void  set_priority();
+	static  void  vop_kick();
+	static  void  vop_start(VRAM_OP * op);
+	static  void  vop_handle();
+	static  bool  vop_push(uint8_t * dst, const uint8_t * src, uint16_t n, uint8_t pat, void (*done)(), uint8_t flags);
 };
 
 extern TNTSC_class TNTSC; // global object usage declaration
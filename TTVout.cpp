@@ -48,6 +48,28 @@
 // updated date 2017/06/25, NTSC object is modified to dynamic generation, NTSC external memory area specification supported
 // Update date 2017/07/29, bug in UP processing of shift () (write to outside of VRAM)
 // Update date 2017/11/18, change the return value of hres (), hres () to int16_t
+// Update date 2026/10/18, gray level of a dot of the 4 gray level modes (set_gray, get_gray) added
+// Update date 2026/10/18, VRAM line stride and half word byte swap (TNTSC SC_DMA16) supported
+// Update date 2026/10/18, raster operation engine (rop_rect) for fill, draw_row, draw_rect and cls
+// Update date 2026/10/18, draw_line draws by byte runs and horizontal / vertical spans
+// Update date 2026/10/18, clip rectangle added, shift () no longer writes outside of VRAM
+// Update date 2026/10/18, bitblt added, bitmap () and print_char () use it
+// Update date 2026/10/18, cls_async, fill_async and shift_async (DMA in the background) added
+// Update date 2026/10/18, shift () by 32 bit words and block moves, shift_rect () added
+// Update date 2026/10/18, print_char () uses a cache of pre-shifted glyphs (set_glyph_cache)
+// Update date 2026/10/18, draw_text () added, write () of strings draws a font line of a run at a time
+// Update date 2026/10/18, numbers formatted without double and per digit division, print_dec (), print_fix () added
+// Update date 2026/10/18, outlined and shadowed text (set_text_style)
+// Update date 2026/10/18, fill_polygon () and fill_triangle () by an edge table
+// Update date 2026/10/18, draw_ellipse (), draw_arc () and draw_rrect () by spans
+// Update date 2026/10/18, draw_bezier () by forward differencing
+// Update date 2026/10/18, thick lines (width of draw_line ()) and draw_polyline () with joins
+// Update date 2026/10/18, fills are drawn with the 8x8 pattern of set_pattern ()
+// Update date 2026/10/18, flood_fill () by runs with a seed stack of fixed size
+// Update date 2026/10/18, rotated and mirrored blits by 8x8 blocks (bitblt_rot), rotated text
+// Update date 2026/10/18, scaled blits by expansion tables (bitblt_scaled), scaled print_char ()
+// Update date 2026/10/18, off-screen bitmaps (set_surface, blit), bit band only for SRAM
+// Update date 2026/10/18, sprites with save-under
 //
 // *Part of this program source is created by Myles Metzers, modified by Avamander and released
 // I am diverting TVout library for Arduino.
@@ -78,12 +100,20 @@
 short tone_pin = -1;        // pin for outputting sound
 short tone_freq = 444;      // tone frequency (0=pause)
 
+template <typename T> int _v_sgn(T val) {return (T(0) < val) - (val < T(0));}
+#ifndef abs
+#define abs(a)  (((a)>0) ? (a) : -(a))
+#endif
+#define swap(a,b) tmp =a;a=b;b=tmp
+
 // Start using TTVout
 void TTVout::begin(uint8_t mode, uint8_t spino, uint8_t* extram) {
     TNTSC->begin(mode, spino,extram);  // Start NTSC video output
     init( TNTSC->VRAM(),  // Start NTSC video output
-    	TNTSC->width(),   // Specify horizontal screen size
-    	TNTSC->height()   // Screen vertical size specification
+    	TNTSC->width() * TNTSC->bpp(), // Specify horizontal screen size (in bits for gray modes)
+    	TNTSC->height(),  // Screen vertical size specification
+    	TNTSC->stride(),  // VRAM bytes per line
+    	TNTSC->byteSwap() // bytes of each half word swapped
      );
 	// Set output pin for tone
 //	pinMode(pwmOutPin, PWM);
@@ -93,14 +123,130 @@ void TTVout::begin(uint8_t mode, uint8_t spino, uint8_t* extram) {
 //
 // Initialization
 //
-void TTVout::init(uint8_t* vram, uint16_t width, uint16_t height) {
-  _screen = vram;  
-  _width  = width;
-  _height = height;
-  _hres   = _width/8;
+void TTVout::init(uint8_t* vram, uint16_t width, uint16_t height, uint16_t stride, uint8_t bswap) {
+  _vram.buf    = vram;
+  _vram.width  = width;
+  _vram.height = height;
+  _vram.stride = stride;
+  _vram.bswap  = bswap;
+  _text_style = TEXT_NORMAL;
+  _text_rot = ROT_0;
+  _pattern_on = false;
+  set_surface(NULL);
+}
+
+// Draw to the bitmap s (NULL: the screen), the clip rectangle is reset to the whole bitmap
+// All the drawing functions work on it, except the asynchronous ones (always the screen).
+// Bit band dots are used only when the bitmap is in the SRAM, else the dots are masked in bytes.
+void TTVout::set_surface(const Surface* s) {
+  if (!s)
+    s = &_vram;
+  _screen = s->buf;
+  _width  = s->width;
+  _height = s->height;
+  _hres   = s->stride;
   _vres   = _height;
-  _adr = (volatile uint32_t*)(BB_SRAM_BASE + ((uint32_t)_screen - BB_SRAM_REF) * 32);
+  _bswap  = s->bswap;
+  if ((uintptr_t)_screen - BB_SRAM_REF < 0x100000)
+    _adr = (volatile uint32_t*)(BB_SRAM_BASE + ((uintptr_t)_screen - BB_SRAM_REF) * 32);
+  else
+    _adr = NULL;
+  resetClipRect();
+}
+
+// Limit drawing to the rectangle (clamped to the screen)
+// cls(), fill() and shift() always work on the whole screen.
+void TTVout::setClipRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  if (w < 0) { x += w; w = -w; }
+  if (h < 0) { y += h; h = -h; }
+  _clip_x0 = x < 0 ? 0 : x;
+  _clip_y0 = y < 0 ? 0 : y;
+  _clip_x1 = x + w > _width  ? _width - 1  : x + w - 1;
+  _clip_y1 = y + h > _height ? _height - 1 : y + h - 1;
+}
+
+// Intersect a rectangle with the clip rectangle (false: nothing is left)
+bool TTVout::clip_box(int16_t& x, int16_t& y, int16_t& w, int16_t& h) {
+  if (w < 0) { x += w; w = -w; }
+  if (h < 0) { y += h; h = -h; }
+  if (x < _clip_x0) { w -= _clip_x0 - x; x = _clip_x0; }
+  if (y < _clip_y0) { h -= _clip_y0 - y; y = _clip_y0; }
+  if (x + w > _clip_x1 + 1) w = _clip_x1 + 1 - x;
+  if (y + h > _clip_y1 + 1) h = _clip_y1 + 1 - y;
+  return w > 0 && h > 0;
+}
+
+// Cohen-Sutherland outcode of a point (1: left 2: right 4: above 8: below)
+uint8_t TTVout::outcode(int16_t x, int16_t y) {
+  uint8_t c = 0;
+  if (x < _clip_x0)      c |= 1;
+  else if (x > _clip_x1) c |= 2;
+  if (y < _clip_y0)      c |= 4;
+  else if (y > _clip_y1) c |= 8;
+  return c;
+}
+
+// Dot of the minor axis at the dot t of the major axis of a line drawn by draw_line()
+// (n, k: length of the major and minor axis)
+static inline int32_t line_minor(int32_t t, int32_t n, int32_t k) {
+  return ((int64_t)2*t*k + n - 1) / (2*n);
+}
+
+// Clip a line to the clip rectangle (false: the line is outside)
+// The ends are moved to the first and last dots of the line inside the clip
+// rectangle and err is set for the new start, so the visible dots are exactly
+// the ones of the unclipped line.
+bool TTVout::clip_line(int16_t& x0, int16_t& y0, int16_t& x1, int16_t& y1, int& err) {
+  int32_t dx = abs(x1-x0), dy = abs(y1-y0);
+  int8_t sx = _v_sgn(x1-x0), sy = _v_sgn(y1-y0);
+  bool xm = dx >= dy;                       // x is the major axis
+  int32_t n = xm ? dx : dy;                 // length of the major axis
+  int32_t k = xm ? dy : dx;                 // length of the minor axis
+  int32_t m0 = xm ? x0 : y0, sm = xm ? sx : sy;
+  int32_t v0 = xm ? y0 : x0, sv = xm ? sy : sx;
+  int32_t lo = xm ? _clip_x0 : _clip_y0, hi = xm ? _clip_x1 : _clip_y1;
+  int32_t vlo = xm ? _clip_y0 : _clip_x0, vhi = xm ? _clip_y1 : _clip_x1;
+  int32_t t0, t1, a, b, i0, j0, i1, j1;
+
+  if (_clip_x1 < _clip_x0 || _clip_y1 < _clip_y0 || (outcode(x0, y0) & outcode(x1, y1)))
+    return false;
+  if (n == 0)
+    return outcode(x0, y0) == 0;
+  // Range of t on the major axis
+  t0 = sm > 0 ? lo - m0 : m0 - hi;
+  t1 = sm > 0 ? hi - m0 : m0 - lo;
+  if (t0 < 0) t0 = 0;
+  if (t1 > n) t1 = n;
+  // Range of the minor axis, relative to the start
+  a = sv > 0 ? vlo - v0 : v0 - vhi;
+  b = sv > 0 ? vhi - v0 : v0 - vlo;
+  if (a > k || b < 0 || (k == 0 && a > 0))
+    return false;
+  if (a > 0) {   // first t with line_minor(t) >= a
+    int32_t t = ((int64_t)2*n*a - n + 1 + 2*k - 1) / (2*k);
+    if (t > t0) t0 = t;
+  }
+  if (b < k) {   // last t with line_minor(t) <= b
+    int32_t t = ((int64_t)2*n*(b + 1) - n) / (2*k);
+    if (t < t1) t1 = t;
+  }
+  if (t0 > t1)
+    return false;
+  i0 = t0; j0 = line_minor(t0, n, k);
+  i1 = t1; j1 = line_minor(t1, n, k);
+  if (!xm) {
+    int32_t t;
+    t = i0; i0 = j0; j0 = t;
+    t = i1; i1 = j1; j1 = t;
+  }
+  err = dx - dy - (int64_t)i0*dy + (int64_t)j0*dx;
+  x1 = x0 + sx*i1;
+  y1 = y0 + sy*j1;
+  x0 = x0 + sx*i0;
+  y0 = y0 + sy*j0;
+  return true;
 }
+
 // Wait between frames
 void TTVout::delay_frame(uint16_t x) {
   TNTSC->delay_frame(x);
@@ -113,108 +259,337 @@ void TTVout::setBktmStartHook(void (*func)()) {
 void TTVout::setBktmEndHook(void (*func)()) {
   TNTSC->setBktmEndHook(func);
 }
+// Raster operation of one byte with the mask m
+static inline void rop_byte(uint8_t* p, uint8_t m, uint8_t op, uint8_t pat) {
+  switch (op) {
+    case ROP_CLEAR: *p &= ~(pat & m); break;
+    case ROP_SET:   *p |= pat & m;    break;
+    case ROP_XOR:   *p ^= pat & m;    break;
+    case ROP_COPY:  *p = (*p & ~m) | (pat & m); break;
+  }
+}
+
 // Draw points
 void TTVout::set_pixel(int16_t x, int16_t y, uint8_t d) {
-	if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height))
+	if ((x < _clip_x0) || (y < _clip_y0) || (x > _clip_x1) || (y > _clip_y1))
 	  return;
   sp(x,y,d);
 }
 // Clear screen
 void TTVout::cls() {
-  memset(_screen, 0, _vres*_hres);
+  rop_screen(ROP_CLEAR);
 }
 // Draw a straight line
-template <typename T> int _v_sgn(T val) {return (T(0) < val) - (val < T(0));}
-#ifndef abs
-#define abs(a)  (((a)>0) ? (a) : -(a))
-#endif
-#define swap(a,b) tmp =a;a=b;b=tmp
-void TTVout::draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t dt){
+// The line is first clipped to the clip rectangle. Horizontal and vertical
+// lines are drawn as spans. Otherwise the dots of a byte are collected into
+// a mask and written at once, and the line address is stepped by the stride
+// instead of being computed for each dot.
+void TTVout::draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t dt, uint8_t width){
    int dx=abs(x1-x0), dy=abs(y1-y0),sx=_v_sgn(x1-x0),sy=_v_sgn(y1-y0);
    int err=dx-dy; 
-   if((x0!=x1)||(y0!=y1))set_pixel(x1,y1,dt);
-   do{ set_pixel(x0,y0,dt);
-       int e2=2*err;
-       if (e2 > -dy){err-=dy;x0+=sx;}
-       if (e2 <  dx){err+=dx;y0+=sy;}
-   }   while ((x0!=x1)||(y0!=y1));
+   if (dt > INVERT)
+     dt = INVERT;
+   if (width > 1) {
+     int16_t pts[4] = { x0, y0, x1, y1 };
+     stroke(pts, 2, dt, width, JOIN_BEVEL);
+     return;
+   }
+   if ((outcode(x0, y0) | outcode(x1, y1)) && !clip_line(x0, y0, x1, y1, err))
+     return;
+   if (y0 == y1) {
+     if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+     rop_span(_screen + _hres*y0, x0, x1+1, dt, 0xff);
+     return;
+   }
+   if (x0 == x1) {
+     draw_column(x0, y0, y1, dt);
+     return;
+   }
+   uint8_t* row = _screen + _hres*y0;
+   int16_t step = sy*_hres;
+   int16_t bx = x0 >> 3;
+   uint8_t m = 0;
+   for (;;) {
+     m |= 0x80 >> (x0&7);
+     if (x0 == x1 && y0 == y1)
+       break;
+     int e2=2*err;
+     if (e2 > -dy){err-=dy;x0+=sx;}
+     if (e2 <  dx){
+       err+=dx;y0+=sy;
+       rop_byte(&row[bx ^ _bswap], m, dt, 0xff);
+       m = 0;
+       row += step;
+     }
+     if ((x0 >> 3) != bx) {
+       if (m)
+         rop_byte(&row[bx ^ _bswap], m, dt, 0xff);
+       m = 0;
+       bx = x0 >> 3;
+     }
+   }
+   rop_byte(&row[bx ^ _bswap], m, dt, 0xff);
 }
 // Acquire the color of the specified coordinates
 uint8_t TTVout::get_pixel(int16_t x, int16_t y) {
 #if BITBAND==1
-  return _adr[_width*y+ (x&0xf8) +7 -(x&7)];
-#else
+  if (_adr)
+    return _adr[(_hres*y + ((x>>3)^_bswap))*8 +7 -(x&7)];
+#endif
   if (x >= _width || y >= _height)
     return 0;
-  if (_screen[(x>>3)+y*_width] & (0x80 >>(x&7)))
+  if (_screen[((x>>3)^_bswap)+y*_hres] & (0x80 >>(x&7)))
     return 1;
   return 0;
-#endif
+}
+
+// Gray level (0..3) of the dot x,y of the 4 gray level modes (TNTSC SC_200x216G4 ...)
+// A dot is 2 bits of VRAM (MSB first), hres() and the clip rectangle count the bits,
+// so x is 0..hres()/2-1. The other drawing functions draw the bits as dots.
+void TTVout::set_gray(int16_t x, int16_t y, uint8_t level) {
+  uint8_t* p;
+  uint8_t s;
+  x *= 2;
+  if (x < _clip_x0 || x + 1 > _clip_x1 || y < _clip_y0 || y > _clip_y1)
+    return;
+  p = &_screen[_hres*y + ((x >> 3) ^ _bswap)];
+  s = 6 - (x & 7);
+  *p = (*p & ~(3 << s)) | ((level & 3) << s);
+}
+
+uint8_t TTVout::get_gray(int16_t x, int16_t y) {
+  x *= 2;
+  if (x < 0 || x + 1 >= _width || y < 0 || y >= _height)
+    return 0;
+  return (_screen[_hres*y + ((x >> 3) ^ _bswap)] >> (6 - (x & 7))) & 3;
 }
 
 // Fill with the specified color of the whole screen
 void TTVout::fill(uint8_t color) {
-  switch(color) {
-    case BLACK:
-      _cursor_x = 0;
-      _cursor_y = 0;
-      for (int16_t i=0; i < _vres; i++)
-        memset( &_screen[i*_hres], 0, _hres);
-      break;
-    case WHITE:
-      _cursor_x = 0;
-      _cursor_y = 0;
-      for (int16_t i=0; i < _vres; i++)
-        memset( &_screen[i*_hres], 0xff, _hres);
-        break;
-    case INVERT:
-      for (int16_t i = 0; i < _vres; i++)
-        for (int16_t j = 0; j < _hres; j++)
-        _screen[i*_hres+j] = ~_screen[i*_hres+j];
-      break;
+  if (color > INVERT)
+    return;
+  if (color != INVERT) {
+    _cursor_x = 0;
+    _cursor_y = 0;
+  }
+  rop_screen(color);   // BLACK, WHITE, INVERT = ROP_CLEAR, ROP_SET, ROP_XOR
+}
+
+// Fill the whole screen by DMA in the background (BLACK or WHITE)
+// The VRAM must not be drawn until done() is called or async_busy() is false.
+// flags VOP_BLANK: start in the vertical blanking period
+bool TTVout::fill_async(uint8_t color, void (*done)(), uint8_t flags) {
+  if (color > WHITE)
+    return false;
+  _cursor_x = 0;
+  _cursor_y = 0;
+  return TNTSC->fillAsync(0, _vram.height, color ? 0xff : 0, done, flags);
+}
+
+// Scroll the screen UP or DOWN by DMA in the background (false: not queued)
+// A line move and a clear of the exposed lines are queued, done() is called after both.
+// Nothing is queued unless the queue has room for both.
+bool TTVout::shift_async(uint8_t distance, uint8_t direction, void (*done)(), uint8_t flags) {
+  uint16_t n;
+  if (direction != UP && direction != DOWN)
+    return false;
+  if (distance >= _vram.height)
+    return TNTSC->fillAsync(0, _vram.height, 0, done, flags);
+  if (TNTSC->asyncFree() < 2)
+    return false;
+  n = _vram.height - distance;
+  if (direction == UP) {
+    TNTSC->moveAsync(0, distance, n, NULL, flags);
+    TNTSC->fillAsync(n, distance, 0, done, flags);
+  } else {
+    TNTSC->moveAsync(distance, 0, n, NULL, flags);
+    TNTSC->fillAsync(0, distance, 0, done, flags);
+  }
+  return true;
+}
+
+// Raster operation of n bytes of memory, 32 bits at a time (OP fixed at compile time)
+// All the bytes of the pattern are the same, so the byte order does not matter.
+template <uint8_t OP> static inline void rop_mem(uint8_t* p, uint16_t n, uint8_t pat) {
+  uint32_t v = pat * 0x01010101UL;
+  uint32_t* w;
+  uint16_t nw;
+
+  if (OP == ROP_COPY || (OP != ROP_XOR && pat == 0xff)) {
+    memset(p, OP == ROP_CLEAR ? 0 : pat, n);   // solid: stores only
+    return;
+  }
+  if (n < 8) {
+    while (n--)
+      rop_byte(p++, 0xff, OP, pat);
+    return;
+  }
+  // Bytes up to the word boundary
+  while ((uintptr_t)p & 3) {
+    rop_byte(p++, 0xff, OP, pat);
+    n--;
+  }
+  w = (uint32_t*)p;
+  nw = n >> 2;
+  if (OP == ROP_CLEAR)
+    v = ~v;
+  for (; nw >= 4; nw -= 4, w += 4) {
+    switch (OP) {
+      case ROP_CLEAR: w[0] &= v; w[1] &= v; w[2] &= v; w[3] &= v; break;
+      case ROP_SET:   w[0] |= v; w[1] |= v; w[2] |= v; w[3] |= v; break;
+      case ROP_XOR:   w[0] ^= v; w[1] ^= v; w[2] ^= v; w[3] ^= v; break;
+      case ROP_COPY:  w[0] = v;  w[1] = v;  w[2] = v;  w[3] = v;  break;
+    }
+  }
+  for (; nw; nw--, w++) {
+    switch (OP) {
+      case ROP_CLEAR: *w &= v; break;
+      case ROP_SET:   *w |= v; break;
+      case ROP_XOR:   *w ^= v; break;
+      case ROP_COPY:  *w = v;  break;
+    }
+  }
+  // Remaining bytes
+  p = (uint8_t*)w;
+  for (n &= 3; n; n--)
+    rop_byte(p++, 0xff, OP, pat);
+}
+
+// rop_span() of one raster operation
+template <uint8_t OP> static void rop_span_op(uint8_t* row, int16_t x0, int16_t x1, uint8_t pat, uint8_t bswap) {
+  int16_t b0 = x0 >> 3;
+  int16_t b1 = (x1 - 1) >> 3;
+  uint8_t lbit = 0xff >> (x0 & 7);
+  uint8_t rbit = 0xff << (7 - ((x1 - 1) & 7));
+
+  if (b0 == b1) {
+    rop_byte(&row[b0 ^ bswap], lbit & rbit, OP, pat);
+    return;
+  }
+  rop_byte(&row[b0 ^ bswap], lbit, OP, pat);
+  rop_byte(&row[b1 ^ bswap], rbit, OP, pat);
+  b0++;
+  if (bswap) {
+    // Whole half words only, then the middle is the same range in memory
+    if ((b0 & 1) && b0 < b1)
+      rop_byte(&row[b0++ ^ 1], 0xff, OP, pat);
+    if ((b1 & 1) && b0 < b1)
+      rop_byte(&row[--b1 ^ 1], 0xff, OP, pat);
   }
+  if (b0 < b1)
+    rop_mem<OP>(row + b0, b1 - b0, pat);
 }
 
-// Draw a horizontal line with the specified color
+// Raster operation of the dots x0 to x1-1 of a line (row: start of the line)
+void TTVout::rop_span(uint8_t* row, int16_t x0, int16_t x1, uint8_t op, uint8_t pat) {
+  switch (op) {
+    case ROP_CLEAR: rop_span_op<ROP_CLEAR>(row, x0, x1, pat, _bswap); break;
+    case ROP_SET:   rop_span_op<ROP_SET>(row, x0, x1, pat, _bswap);   break;
+    case ROP_XOR:   rop_span_op<ROP_XOR>(row, x0, x1, pat, _bswap);   break;
+    case ROP_COPY:  rop_span_op<ROP_COPY>(row, x0, x1, pat, _bswap);  break;
+  }
+}
+
+// Raster operation of the whole screen (the clip rectangle is ignored)
+// BLACK and WHITE of lines of whole bytes (half words if swapped) are memset(),
+// of all the lines at once if there are no bytes after the dots of a line.
+void TTVout::rop_screen(uint8_t op) {
+  uint8_t* row = _screen;
+  uint16_t n = _width >> 3, h = _vres;
+
+  if (op != ROP_XOR && !(_width & 7) && !(_bswap && (n & 1))) {
+    if (n == _hres) {
+      n *= h;
+      h = 1;
+    }
+    for (; h; h--, row += _hres)
+      memset(row, op == ROP_SET ? 0xff : 0, n);
+    return;
+  }
+  for (; h; h--, row += _hres)
+    rop_span(row, 0, _width, op, 0xff);
+}
+
+// Raster operation of a rectangle (pat: pattern byte, 0xff = solid)
+void TTVout::rop_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t op, uint8_t pat) {
+  uint8_t* row;
+
+  if (!clip_box(x, y, w, h))
+    return;
+  row = _screen + _hres*y;
+  while (h--) {
+    rop_span(row, x, x + w, op, pat);
+    row += _hres;
+  }
+}
+
+// Draw a horizontal line with the specified color (x1 is not drawn)
 void TTVout::draw_row(int16_t line, int16_t x0, int16_t x1, uint8_t c) {
-  uint8_t lbit, rbit;
+  int16_t tmp;
   if (x0 == x1)
     set_pixel(x0,line,c);
-  else {
+  else if (c <= INVERT) {
+    if (line < _clip_y0 || line > _clip_y1)
+      return;
     if (x0 > x1) {
-      lbit = x0;
+      tmp = x0;
       x0 = x1;
-      x1 = lbit;
+      x1 = tmp;
     }
-    lbit = 0xff >> (x0&7);
-    x0 = x0/8 + _hres*line;
-    rbit = ~(0xff >> (x1&7));
-    x1 = x1/8 + _hres*line;
-    if (x0 == x1) {
-      lbit = lbit & rbit;
-      rbit = 0;
-    }
-    if (c == WHITE) {
-      _screen[x0++] |= lbit;
-      while (x0 < x1)
-        _screen[x0++] = 0xff;
-      _screen[x0] |= rbit;
-    }
-    else if (c == BLACK) {
-      _screen[x0++] &= ~lbit;
-      while (x0 < x1)
-        _screen[x0++] = 0;
-      _screen[x0] &= ~rbit;
-    }
-    else if (c == INVERT) {
-      _screen[x0++] ^= lbit;
-      while (x0 < x1)
-        _screen[x0++] ^= 0xff;
-      _screen[x0] ^= rbit;
+    if (x0 < _clip_x0)     x0 = _clip_x0;
+    if (x1 > _clip_x1 + 1) x1 = _clip_x1 + 1;
+    if (x0 >= x1)
+      return;
+    switch (c) {
+      case BLACK:  rop_span_op<ROP_CLEAR>(_screen + _hres*line, x0, x1, 0xff, _bswap); break;
+      case WHITE:  rop_span_op<ROP_SET>(_screen + _hres*line, x0, x1, 0xff, _bswap);   break;
+      case INVERT: rop_span_op<ROP_XOR>(_screen + _hres*line, x0, x1, 0xff, _bswap);   break;
     }
   }	
 }
 
+// Patterns of set_pattern()
+const uint8_t PAT_GRAY25[8] = { 0x88, 0x00, 0x22, 0x00, 0x88, 0x00, 0x22, 0x00 };
+const uint8_t PAT_GRAY50[8] = { 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55 };
+const uint8_t PAT_GRAY75[8] = { 0x77, 0xff, 0xdd, 0xff, 0x77, 0xff, 0xdd, 0xff };
+
+// Brush of the fills, the dot (ox,oy) is the upper left of the pattern (pat NULL: solid)
+// The lines are rotated here, a fill takes the byte of its line and the spans are
+// drawn with it as fast as solid ones.
+void TTVout::set_pattern(const uint8_t* pat, int16_t ox, int16_t oy) {
+  uint8_t s = ox & 7, p;
+
+  _pattern_on = pat != NULL;
+  if (!pat)
+    return;
+  for (uint8_t i = 0; i < 8; i++) {
+    p = pat[(i - oy) & 7];
+    _pattern[i] = s ? (p >> s) | (p << (8 - s)) : p;
+  }
+}
+
+// draw_row() of fills, with the pattern of set_pattern() (pat false: solid)
+void TTVout::fill_row(int16_t line, int16_t x0, int16_t x1, uint8_t c, bool pat) {
+  int16_t tmp;
+
+  if (!pat || !_pattern_on) {
+    draw_row(line, x0, x1, c);
+    return;
+  }
+  if (c > INVERT || line < _clip_y0 || line > _clip_y1)
+    return;
+  if (x0 > x1) {
+    tmp = x0;
+    x0 = x1;
+    x1 = tmp;
+  } else if (x0 == x1)
+    x1++;
+  if (x0 < _clip_x0)     x0 = _clip_x0;
+  if (x1 > _clip_x1 + 1) x1 = _clip_x1 + 1;
+  if (x0 < x1)
+    rop_span(_screen + _hres*line, x0, x1, c, _pattern[line & 7]);
+}
+
 // Draw a vertical line with the specified color
 void TTVout::draw_column(int16_t row, int16_t y0, int16_t y1, uint8_t c) {
 
@@ -224,13 +599,17 @@ void TTVout::draw_column(int16_t row, int16_t y0, int16_t y1, uint8_t c) {
   if (y0 == y1)
     set_pixel(row,y0,c);
   else {
+    if (row < _clip_x0 || row > _clip_x1)
+      return;
     if (y1 < y0) {
-      bit = y0;
+      byte = y0;
       y0 = y1;
-      y1 = bit;
+      y1 = byte;
     }
+    if (y0 < _clip_y0) y0 = _clip_y0;
+    if (y1 > _clip_y1) y1 = _clip_y1;
     bit = 0x80 >> (row&7);
-    byte = row/8 + y0*_hres;
+    byte = ((row/8)^_bswap) + y0*_hres;
     if (c == WHITE) {
       while ( y0 <= y1) {
         _screen[byte] |= bit;
@@ -274,10 +653,19 @@ void TTVout::draw_rect(int16_t x0, int16_t y0, int16_t w, int16_t h, uint8_t c,
 	         draw_line(x0+w,y0+1,x0+w,y0+h-1,c);
 		   }
 		}
-	} else {
+	} else if (w == 0) {
 		for (int16_t i = y0; i < y0+h; i++) {
-          draw_row(i,x0,x0+w,c);
+          fill_row(i,x0,x0+w,c);
 		}
+	} else if (c <= INVERT && _pattern_on) {
+		// Negative w, h as rop_rect(), each line with its byte of the pattern
+		if (!clip_box(x0, y0, w, h))
+			return;
+		uint8_t* row = _screen + _hres*y0;
+		for (int16_t i = y0; i < y0+h; i++, row += _hres)
+		  rop_span(row, x0, x0+w, c, _pattern[i & 7]);
+	} else if (c <= INVERT) {
+		rop_rect(x0, y0, w, h, c);
 	}
 }
 
@@ -294,7 +682,7 @@ void TTVout::draw_circle(int16_t x0, int16_t y0, int16_t radius, uint8_t c, int8
   //there is a fill color
 
   if (fc != -1)
-    draw_row(y0,x0-radius,x0+radius,c);
+    fill_row(y0,x0-radius,x0+radius,c);
   
   set_pixel(x0, y0 + radius,c);
   set_pixel(x0, y0 - radius,c);
@@ -316,13 +704,13 @@ void TTVout::draw_circle(int16_t x0, int16_t y0, int16_t radius, uint8_t c, int8
     if (fc != -1) {
       //prevent double draws on the same rows
       if (pyy != y) {
-        draw_row(y0+y,x0-x,x0+x,c);
-        draw_row(y0-y,x0-x,x0+x,c);
+        fill_row(y0+y,x0-x,x0+x,c);
+        fill_row(y0-y,x0-x,x0+x,c);
       }
     	
       if (pyx != x && x != y) {
-        draw_row(y0+x,x0-y,x0+y,c);
-        draw_row(y0-x,x0-y,x0+y,c);
+        fill_row(y0+x,x0-y,x0+y,c);
+        fill_row(y0-x,x0-y,x0+y,c);
       }
 
       pyy = y;
@@ -339,15 +727,731 @@ void TTVout::draw_circle(int16_t x0, int16_t y0, int16_t radius, uint8_t c, int8
   }
 }
 
+// sin() of 0 to 90 degrees (x 16384)
+static const int16_t sin_tbl[91] = {
+      0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+   2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+   5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+   8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+  10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+  12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+  14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+  15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+  16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+  16384
+};
+
+static int16_t sin_deg(int16_t a) {
+  a %= 360;
+  if (a < 0)
+    a += 360;
+  if (a < 90)  return sin_tbl[a];
+  if (a < 180) return sin_tbl[180 - a];
+  if (a < 270) return -sin_tbl[a - 180];
+  return -sin_tbl[360 - a];
+}
+
+// Angle range of draw_arc(), the directions of its ends (x 16384)
+struct ArcSector {
+  int16_t x, y;     // center
+  int16_t sx, sy;   // start
+  int16_t ex, ey;   // end
+  bool wide;        // more than 180 degrees
+};
+
+// a / b rounded down (b > 0)
+static inline int64_t floor_div(int64_t a, int32_t b) {
+  int64_t q = a / b;
+  return (a % b && a < 0) ? q - 1 : q;
+}
+
+// Dots dx of the line dy on the clockwise side of the direction (vx,vy): vx*dy - vy*dx >= 0
+static void half_line(int16_t vx, int16_t vy, int16_t dy, int16_t& lo, int16_t& hi) {
+  int32_t n = (int32_t)vx * dy;
+
+  lo = -0x7fff;
+  hi = 0x7fff;
+  if (vy > 0)
+    hi = floor_div(n, vy);
+  else if (vy < 0)
+    lo = -floor_div(n, -vy);
+  else if (n < 0)
+    lo = 1, hi = 0;
+}
+
+// Span a..b (inclusive) of the line y, only the dots within the angle range of as (NULL: all)
+void TTVout::arc_span(int16_t y, int16_t a, int16_t b, uint8_t c, bool fill, const ArcSector* as) {
+  int16_t l0, h0, l1, h1;
+
+  if (!as) {
+    fill_row(y, a, b + 1, c, fill);
+    return;
+  }
+  half_line(as->sx, as->sy, y - as->y, l0, h0);
+  half_line(-as->ex, -as->ey, y - as->y, l1, h1);
+  a -= as->x;
+  b -= as->x;
+  if (!as->wide) {
+    // Both sides (up to 180 degrees)
+    if (l1 > l0) l0 = l1;
+    if (h1 < h0) h0 = h1;
+    if (l0 < a) l0 = a;
+    if (h0 > b) h0 = b;
+    if (l0 <= h0)
+      fill_row(y, as->x + l0, as->x + h0 + 1, c, fill);
+    return;
+  }
+  // Either side, two spans at most
+  if (l0 < a) l0 = a;
+  if (h0 > b) h0 = b;
+  if (l1 < a) l1 = a;
+  if (h1 > b) h1 = b;
+  if (l0 > h0) {
+    l0 = l1;
+    h0 = h1;
+  } else if (l1 <= h1) {
+    if (l1 <= h0 + 1 && l0 <= h1 + 1) {
+      if (l1 < l0) l0 = l1;
+      if (h1 > h0) h0 = h1;
+    } else
+      fill_row(y, as->x + l1, as->x + h1 + 1, c, fill);
+  }
+  if (l0 <= h0)
+    fill_row(y, as->x + l0, as->x + h0 + 1, c, fill);
+}
+
+// Box cx0..cx1, cy0..cy1 grown by an ellipse of the radii rx, ry (outline or filled) by spans
+// A dot (x,y) of a corner is inside if (x/(rx+0.5))^2 + (y/(ry+0.5))^2 <= 1, the half width
+// of the next line is found by stepping x down. The outline of a line is the part outside
+// of the next line further from the center, at least the end dots.
+void TTVout::round_shape(int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1, int16_t rx, int16_t ry,
+                         uint8_t c, bool fill, const ArcSector* as) {
+  int64_t a = (int64_t)(2*rx + 1) * (2*rx + 1);
+  int64_t b = (int64_t)(2*ry + 1) * (2*ry + 1);
+  int64_t t = a * b, yy;
+  int16_t x = rx, dy, y, cur = rx, nxt, l, r, ll, rr, i;
+
+  if (rx < 0 || ry < 0 || c > INVERT)
+    return;
+  for (dy = 0; dy <= ry; dy++) {
+    if (dy < ry) {
+      yy = 4 * (int64_t)(dy + 1) * (dy + 1) * a;
+      while (x > 0 && 4 * (int64_t)x * x * b + yy > t)
+        x--;
+      nxt = x;
+    } else
+      nxt = -1;
+    l = cx0 - cur;
+    r = cx1 + cur;
+    for (i = dy ? 0 : cy0; i <= (dy ? 1 : cy1); i++) {
+      y = dy ? (i ? cy1 + dy : cy0 - dy) : i;
+      if (fill || (nxt < 0 && (dy || y == cy0 || y == cy1))) {
+        arc_span(y, l, r, c, fill, as);
+        continue;
+      }
+      // Outline, the next line is the same in the middle of the box
+      ll = cx0 - (dy || y == cy0 || y == cy1 ? nxt : cur) - 1;
+      rr = cx1 + (dy || y == cy0 || y == cy1 ? nxt : cur) + 1;
+      if (ll < l) ll = l;
+      if (rr > r) rr = r;
+      if (ll + 1 >= rr)
+        arc_span(y, l, r, c, false, as);
+      else {
+        arc_span(y, l, ll, c, false, as);
+        arc_span(y, rr, r, c, false, as);
+      }
+    }
+    cur = nxt;
+  }
+}
+
+// Draw an ellipse of the radii rx, ry (fc != -1: filled with c)
+void TTVout::draw_ellipse(int16_t x0, int16_t y0, int16_t rx, int16_t ry, uint8_t c, int8_t fc) {
+  round_shape(x0, y0, x0, y0, rx, ry, c, fc != -1, NULL);
+}
+
+// Draw the part of an ellipse from the angle start to end (degrees, 0: right, clockwise)
+// fc != -1: filled sector (pie)
+void TTVout::draw_arc(int16_t x0, int16_t y0, int16_t rx, int16_t ry, int16_t start, int16_t end, uint8_t c, int8_t fc) {
+  ArcSector as;
+  int16_t sweep = (end - start) % 360;
+
+  if (end == start)
+    return;
+  if (sweep == 0) {
+    round_shape(x0, y0, x0, y0, rx, ry, c, fc != -1, NULL);
+    return;
+  }
+  if (sweep < 0)
+    sweep += 360;
+  as.x = x0;
+  as.y = y0;
+  as.sx = sin_deg(start + 90);
+  as.sy = sin_deg(start);
+  as.ex = sin_deg(end + 90);
+  as.ey = sin_deg(end);
+  as.wide = sweep > 180;
+  round_shape(x0, y0, x0, y0, rx, ry, c, fc != -1, &as);
+}
+
+// Draw a rectangle with round corners of the radius r (fc != -1: filled with c)
+void TTVout::draw_rrect(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t r, uint8_t c, int8_t fc) {
+  if (w <= 0 || h <= 0)
+    return;
+  if (r > (w - 1)/2) r = (w - 1)/2;
+  if (r > (h - 1)/2) r = (h - 1)/2;
+  if (r < 0) r = 0;
+  round_shape(x0 + r, y0 + r, x0 + w - 1 - r, y0 + h - 1 - r, r, r, c, fc != -1, NULL);
+}
+
+// Forward differences of a t^3 + b t^2 + c t + d at t = i / 2^k, in units of 2^-3k
+// All integer, so the points are exact (rounded) and the last one is the end point.
+struct FwdDiff {
+  int64_t f, d1, d2, d3;
+  uint8_t sh;
+
+  FwdDiff(const int32_t* p, uint8_t k) : sh(3*k) {
+    int64_t n = 1L << k;
+    f  = p[3] * n * n * n;
+    d1 = p[0] + p[1] * n + p[2] * n * n;
+    d2 = 6 * p[0] + 2 * p[1] * n;
+    d3 = 6 * (int64_t)p[0];
+  }
+  int16_t next() {
+    f += d1;
+    d1 += d2;
+    d2 += d3;
+    return sh ? (f + (1L << (sh - 1))) >> sh : f;
+  }
+};
+
+// Draw the curve of the polynomial coefficients px, py (a, b, c, d) by lines
+// len: length of the control polygon, one segment per 8 dots of it (up to 64)
+void TTVout::draw_curve(const int32_t* px, const int32_t* py, uint32_t len, uint8_t c) {
+  uint8_t k = 0;
+  uint16_t n;
+  int16_t x0 = px[3], y0 = py[3], x1, y1;
+  bool joint = false;
+
+  while (k < 6 && (8U << k) < len)
+    k++;
+  FwdDiff fx(px, k), fy(py, k);
+  for (n = 1 << k; n; n--) {
+    x1 = fx.next();
+    y1 = fy.next();
+    if (x1 == x0 && y1 == y0)
+      continue;
+    draw_line(x0, y0, x1, y1, c);
+    if (joint && c >= INVERT)   // the joint was inverted twice
+      set_pixel(x0, y0, INVERT);
+    joint = true;
+    x0 = x1;
+    y0 = y1;
+  }
+  if (!joint)
+    set_pixel(x0, y0, c);
+}
+
+// Draw a quadratic Bezier curve from (x0,y0) to (x2,y2) with the control point (x1,y1)
+void TTVout::draw_bezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t c) {
+  int32_t px[4] = { 0, x0 - 2*x1 + x2, 2*(x1 - x0), x0 };
+  int32_t py[4] = { 0, y0 - 2*y1 + y2, 2*(y1 - y0), y0 };
+  draw_curve(px, py, abs(x1-x0) + abs(y1-y0) + abs(x2-x1) + abs(y2-y1), c);
+}
+
+// Draw a cubic Bezier curve from (x0,y0) to (x3,y3) with the control points (x1,y1), (x2,y2)
+void TTVout::draw_bezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+                         int16_t x3, int16_t y3, uint8_t c) {
+  int32_t px[4] = { -x0 + 3*x1 - 3*x2 + x3, 3*x0 - 6*x1 + 3*x2, 3*(x1 - x0), x0 };
+  int32_t py[4] = { -y0 + 3*y1 - 3*y2 + y3, 3*y0 - 6*y1 + 3*y2, 3*(y1 - y0), y0 };
+  draw_curve(px, py, abs(x1-x0) + abs(y1-y0) + abs(x2-x1) + abs(y2-y1) + abs(x3-x2) + abs(y3-y2), c);
+}
+
+// Square root rounded down
+static uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0, b = (uint64_t)1 << 62;
+
+  while (b > v)
+    b >>= 2;
+  while (b) {
+    if (v >= r + b) {
+      v -= r + b;
+      r = (r >> 1) + b;
+    } else
+      r >>= 1;
+    b >>= 2;
+  }
+  return r;
+}
+
+// Dots xa..xb-1 of the line y inside the convex polygon vx, vy (24.8 fixed point)
+// Same sampling as fill_polygon(): the dot centers, right and bottom edges excluded.
+static bool convex_span(const int32_t* vx, const int32_t* vy, uint8_t n, int16_t y, int16_t& xa, int16_t& xb) {
+  int32_t yf = (int32_t)y * 256, lo = 0x7fffffff, hi = -0x7fffffff, x;
+  uint8_t i, j;
+
+  for (i = 0; i < n; i++) {
+    j = i + 1 < n ? i + 1 : 0;
+    if ((yf < vy[i]) == (yf < vy[j]))
+      continue;
+    if (vy[j] > vy[i])
+      x = vx[i] + floor_div((int64_t)(yf - vy[i]) * (vx[j] - vx[i]), vy[j] - vy[i]);
+    else
+      x = vx[i] + floor_div((int64_t)(vy[i] - yf) * (vx[j] - vx[i]), vy[i] - vy[j]);
+    if (x < lo) lo = x;
+    if (x > hi) hi = x;
+  }
+  if (lo > hi)
+    return false;
+  xa = (lo + 255) >> 8;
+  xb = (hi + 255) >> 8;
+  return xa < xb;
+}
+
+// Add the span a..b-1 to the spans of a line, in the order of a
+static inline void add_span(int16_t* sp, uint8_t& ns, int16_t a, int16_t b) {
+  uint8_t k;
+  for (k = ns++; k > 0 && sp[2*k-2] > a; k--) {
+    sp[2*k] = sp[2*k-2];
+    sp[2*k+1] = sp[2*k-1];
+  }
+  sp[2*k] = a;
+  sp[2*k+1] = b;
+}
+
+// Thick polyline: the segments are quads (the ends extended by half a dot, as
+// a 1 dot line), the joints bevel or miter pieces on the outside of the turn.
+// On each line the spans of the pieces are merged, so every dot is drawn once.
+void TTVout::stroke(const int16_t* pts, uint8_t n, uint8_t c, uint8_t width, uint8_t join) {
+  int16_t px[POLY_MAX_POINTS], py[POLY_MAX_POINTS];
+  int16_t nx[POLY_MAX_POINTS], ny[POLY_MAX_POINTS];    // unit normals of the segments (x 16384)
+  int16_t sp[4*POLY_MAX_POINTS];                       // spans of a line
+  int32_t vx[4], vy[4], h = width * 128, ox, oy, dx, dy;  // half width (24.8)
+  uint8_t m = 0, i, ns;
+  int16_t y, y0 = 0x7fff, y1 = -0x7fff, xa, xb;
+
+  // Points without repeats
+  if (n > POLY_MAX_POINTS)
+    n = POLY_MAX_POINTS;
+  for (i = 0; i < n; i++)
+    if (!m || pts[2*i] != px[m-1] || pts[2*i+1] != py[m-1]) {
+      px[m] = pts[2*i];
+      py[m] = pts[2*i+1];
+      if (py[m] - width < y0) y0 = py[m] - width;
+      if (py[m] + width > y1) y1 = py[m] + width;
+      m++;
+    }
+  if (m == 0 || c > INVERT)
+    return;
+  if (m == 1) {
+    rop_rect(px[0] - width/2, py[0] - width/2, width, width, c);
+    return;
+  }
+  for (i = 0; i + 1 < m; i++) {
+    dx = px[i+1] - px[i];
+    dy = py[i+1] - py[i];
+    uint32_t len = isqrt64(((uint64_t)((int64_t)dx*dx + (int64_t)dy*dy)) << 16);  // x 256
+    nx[i] = -(int64_t)dy * (16384 * 256) / len;
+    ny[i] = (int64_t)dx * (16384 * 256) / len;
+  }
+  if (y0 < _clip_y0) y0 = _clip_y0;
+  if (y1 > _clip_y1) y1 = _clip_y1;
+
+  for (y = y0; y <= y1; y++) {
+    ns = 0;
+    // Segments
+    for (i = 0; i + 1 < m; i++) {
+      if ((y < py[i] - width && y < py[i+1] - width) || (y > py[i] + width && y > py[i+1] + width))
+        continue;
+      int32_t c0 = i == 0 ? 128 : 0, c1 = i + 2 == m ? 128 : 0;   // ends of the polyline
+      ox = h * nx[i] >> 14;
+      oy = h * ny[i] >> 14;
+      dx = ny[i];                 // direction
+      dy = -nx[i];
+      vx[0] = px[i] * 256 - (c0 * dx >> 14) + ox;
+      vy[0] = py[i] * 256 - (c0 * dy >> 14) + oy;
+      vx[1] = px[i+1] * 256 + (c1 * dx >> 14) + ox;
+      vy[1] = py[i+1] * 256 + (c1 * dy >> 14) + oy;
+      vx[2] = vx[1] - 2*ox;
+      vy[2] = vy[1] - 2*oy;
+      vx[3] = vx[0] - 2*ox;
+      vy[3] = vy[0] - 2*oy;
+      if (convex_span(vx, vy, 4, y, xa, xb))
+        add_span(sp, ns, xa, xb);
+    }
+    // Joints
+    for (i = 1; i + 1 < m; i++) {
+      if (y < py[i] - width || y > py[i] + width)
+        continue;
+      int32_t cr = (int32_t)nx[i-1] * ny[i] - (int32_t)ny[i-1] * nx[i];
+      int32_t s = cr > 0 ? -1 : 1;                                   // outside of the turn
+      int32_t k = 16384 + (((int32_t)nx[i-1] * nx[i] + (int32_t)ny[i-1] * ny[i]) >> 14);
+      if (cr == 0)
+        continue;
+      vx[0] = px[i] * 256;
+      vy[0] = py[i] * 256;
+      vx[1] = vx[0] + s * (h * nx[i-1] >> 14);
+      vy[1] = vy[0] + s * (h * ny[i-1] >> 14);
+      if (join == JOIN_MITER && k >= 8192) {   // miter up to twice the half width
+        vx[3] = vx[0] + s * (h * nx[i] >> 14);
+        vy[3] = vy[0] + s * (h * ny[i] >> 14);
+        vx[2] = vx[0] + s * (int64_t)h * (nx[i-1] + nx[i]) / k;
+        vy[2] = vy[0] + s * (int64_t)h * (ny[i-1] + ny[i]) / k;
+        if (convex_span(vx, vy, 4, y, xa, xb))
+          add_span(sp, ns, xa, xb);
+      } else {
+        vx[2] = vx[0] + s * (h * nx[i] >> 14);
+        vy[2] = vy[0] + s * (h * ny[i] >> 14);
+        if (convex_span(vx, vy, 3, y, xa, xb))
+          add_span(sp, ns, xa, xb);
+      }
+    }
+    // Union of the spans
+    for (i = 0; i < ns; i++) {
+      xa = sp[2*i];
+      xb = sp[2*i+1];
+      while (i + 1 < ns && sp[2*i+2] <= xb) {
+        i++;
+        if (sp[2*i+1] > xb)
+          xb = sp[2*i+1];
+      }
+      draw_row(y, xa, xb, c);
+    }
+  }
+}
+
+// Draw the lines through n points (pts: x,y pairs, up to POLY_MAX_POINTS)
+// width: line width in dots, join: JOIN_MITER or JOIN_BEVEL
+void TTVout::draw_polyline(const int16_t* pts, uint8_t n, uint8_t c, uint8_t width, uint8_t join) {
+  uint8_t i;
+
+  if (c > INVERT)
+    c = INVERT;
+  if (width > 1) {
+    stroke(pts, n, c, width, join);
+    return;
+  }
+  if (n == 1)
+    set_pixel(pts[0], pts[1], c);
+  for (i = 1; i < n; i++) {
+    draw_line(pts[2*i-2], pts[2*i-1], pts[2*i], pts[2*i+1], c);
+    if (i > 1 && c == INVERT)   // the joint was inverted twice
+      set_pixel(pts[2*i-2], pts[2*i-1], INVERT);
+  }
+}
+
+// Edge of fill_polygon(), x in 16.16 fixed point
+struct PolyEdge {
+  int32_t x;       // x of the current line
+  int32_t dx;      // x step per line
+  int16_t x0, y0;  // upper end
+  int16_t x1, y1;  // lower end (the line y1 is not crossed)
+};
+
+// Fill a polygon of n vertices (pts: x,y pairs, up to POLY_MAX_POINTS) with the color c
+// A dot (x,y) is filled when the line y crosses the edges an odd number of times
+// left of x, so a polygon of the corners of a rectangle fills the same dots as
+// draw_rect() with a fill color. The spans are drawn by fill_row()
+// with the pattern of set_pattern().
+void TTVout::fill_polygon(const int16_t* pts, uint8_t n, uint8_t c) {
+  PolyEdge e[POLY_MAX_POINTS];
+  PolyEdge t;
+  uint8_t act[POLY_MAX_POINTS];         // edges crossing the line, in the order of x
+  uint8_t ne = 0, na = 0, next = 0, i, j, k;
+  int16_t y, y1;
+  int32_t xa, xb;
+
+  if (n > POLY_MAX_POINTS)
+    n = POLY_MAX_POINTS;
+  if (n < 3 || c > INVERT)
+    return;
+
+  // Edge table in the order of the upper end, horizontal edges are left out
+  y = 0x7fff;
+  y1 = -0x7fff;
+  for (i = 0; i < n; i++) {
+    j = i + 1 < n ? i + 1 : 0;
+    if (pts[2*i+1] == pts[2*j+1])
+      continue;
+    k = pts[2*i+1] < pts[2*j+1] ? i : j;
+    t.x0 = pts[2*k];
+    t.y0 = pts[2*k+1];
+    k = k == i ? j : i;
+    t.x1 = pts[2*k];
+    t.y1 = pts[2*k+1];
+    t.dx = floor_div((int64_t)(t.x1 - t.x0) * 65536, t.y1 - t.y0);
+    for (k = ne++; k > 0 && e[k-1].y0 > t.y0; k--)
+      e[k] = e[k-1];
+    e[k] = t;
+    if (t.y0 < y)  y = t.y0;
+    if (t.y1 > y1) y1 = t.y1;
+  }
+  if (y < _clip_y0)     y = _clip_y0;
+  if (y1 > _clip_y1 + 1) y1 = _clip_y1 + 1;
+
+  for (; y < y1; y++) {
+    // Edges reaching the line, x exactly at the first line
+    for (; next < ne && e[next].y0 <= y; next++) {
+      PolyEdge* p = &e[next];
+      if (p->y1 <= y)
+        continue;
+      p->x = (int32_t)p->x0 * 65536 + floor_div((int64_t)(p->x1 - p->x0) * (y - p->y0) * 65536, p->y1 - p->y0);
+      for (k = na++; k > 0 && e[act[k-1]].x > p->x; k--)
+        act[k] = act[k-1];
+      act[k] = next;
+    }
+
+    // Spans between the pairs of crossings (the dots from ceil(xa) to ceil(xb)-1)
+    for (i = 0; i + 1 < na; i += 2) {
+      xa = (e[act[i]].x + 0xffff) >> 16;
+      xb = (e[act[i+1]].x + 0xffff) >> 16;
+      if (xa < _clip_x0)     xa = _clip_x0;
+      if (xb > _clip_x1 + 1) xb = _clip_x1 + 1;
+      if (xa < xb)
+        fill_row(y, xa, xb, c);
+    }
+
+    // Next line, drop the finished edges and keep the order of x
+    for (i = j = 0; i < na; i++) {
+      uint8_t a = act[i];
+      if (e[a].y1 > y + 1) {
+        e[a].x += e[a].dx;
+        for (k = j++; k > 0 && e[act[k-1]].x > e[a].x; k--)
+          act[k] = act[k-1];
+        act[k] = a;
+      }
+    }
+    na = j;
+  }
+}
+
+void TTVout::fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t c) {
+  int16_t pts[6] = { x0, y0, x1, y1, x2, y2 };
+  fill_polygon(pts, 3, c);
+}
+
+// First dot from x to x1 of a line (row: start) not of the color t (x1 + 1: none)
+// Bytes and whole words of the color t are skipped at once.
+static int16_t run_end(const uint8_t* row, int16_t x, int16_t x1, uint8_t t, uint8_t bswap) {
+  uint8_t m = t ? 0xff : 0;
+  int16_t b = x >> 3;
+  uint8_t d;
+
+  if (x > x1)
+    return x1 + 1;    // x may be the dot after the line
+  d = (row[b ^ bswap] ^ m) & (0xff >> (x & 7));
+  while (!d) {
+    b++;
+    if (!(b & 3) && !((uintptr_t)row & 3))
+      while (b + 3 <= (x1 >> 3) && *(const uint32_t*)(row + b) == m * 0x01010101UL)
+        b += 4;
+    if (b > (x1 >> 3))
+      return x1 + 1;
+    d = row[b ^ bswap] ^ m;
+  }
+  x = (b << 3) + __builtin_clz(d) - 24;
+  return x > x1 ? x1 + 1 : x;
+}
+
+// First dot from x down to x0 of a line not of the color t (x0 - 1: none)
+static int16_t run_start(const uint8_t* row, int16_t x, int16_t x0, uint8_t t, uint8_t bswap) {
+  uint8_t m = t ? 0xff : 0;
+  int16_t b = x >> 3;
+  uint8_t d;
+
+  if (x < x0)
+    return x0 - 1;
+  d = (row[b ^ bswap] ^ m) & (0xff << (7 - (x & 7)));
+  while (!d) {
+    b--;
+    if ((b & 3) == 3 && !((uintptr_t)row & 3))
+      while (b - 3 >= (x0 >> 3) && *(const uint32_t*)(row + b - 3) == m * 0x01010101UL)
+        b -= 4;
+    if (b < (x0 >> 3))
+      return x0 - 1;
+    d = row[b ^ bswap] ^ m;
+  }
+  x = (b << 3) + 7 - __builtin_ctz(d);
+  return x < x0 ? x0 - 1 : x;
+}
+
+// Fill the area of the color of (x,y) (4 connected, within the clip rectangle) with c
+// The runs of a seed are found and filled a byte or word at a time, a seed is kept
+// for each run of the area on the lines above and below. buf: seed stack of size
+// bytes (4 bytes a seed, NULL: FLOOD_SEEDS seeds on the stack). When it is full the
+// seeds are rescanned and the ones filled since are dropped, if still full the seed
+// is lost and false is returned (a part of the area may be left unfilled).
+bool TTVout::flood_fill(int16_t x, int16_t y, uint8_t c, void* buf, uint16_t size) {
+  int16_t local[2 * FLOOD_SEEDS];
+  int16_t* stk = buf ? (int16_t*)buf : local;
+  uint16_t cap = buf ? size / 4 : FLOOD_SEEDS, n = 0, i, j;
+  int16_t xl, xr, yy, e;
+  uint8_t t, *row;
+  bool lost = false;
+
+  if (c > INVERT || x < _clip_x0 || x > _clip_x1 || y < _clip_y0 || y > _clip_y1)
+    return true;
+  row = _screen + _hres*y;
+  t = (row[(x >> 3) ^ _bswap] >> (7 - (x & 7))) & 1;
+  if (c == INVERT)
+    c = !t;
+  if (c == t)
+    return true;
+  if (!cap)
+    return false;
+  stk[0] = x;
+  stk[1] = y;
+  n = 1;
+  while (n) {
+    n--;
+    x = stk[2*n];
+    y = stk[2*n+1];
+    row = _screen + _hres*y;
+    if (((row[(x >> 3) ^ _bswap] >> (7 - (x & 7))) & 1) != t)
+      continue;   // filled from another seed
+    xl = run_start(row, x, _clip_x0, t, _bswap) + 1;
+    xr = run_end(row, x, _clip_x1, t, _bswap);
+    rop_span(row, xl, xr, c, 0xff);
+    // Runs of the area touching xl..xr-1 on the next lines
+    for (yy = y - 1; yy <= y + 1; yy += 2) {
+      if (yy < _clip_y0 || yy > _clip_y1)
+        continue;
+      row = _screen + _hres*yy;
+      for (x = xl; (x = run_end(row, x, xr - 1, !t, _bswap)) < xr; x = e) {
+        e = run_end(row, x, _clip_x1, t, _bswap);
+        if (n == cap) {
+          // Full, drop the seeds filled since they were pushed
+          for (i = j = 0; i < n; i++) {
+            uint8_t* r = _screen + _hres*stk[2*i+1];
+            if (((r[(stk[2*i] >> 3) ^ _bswap] >> (7 - (stk[2*i] & 7))) & 1) == t) {
+              stk[2*j] = stk[2*i];
+              stk[2*j+1] = stk[2*i+1];
+              j++;
+            }
+          }
+          n = j;
+          if (n == cap) {
+            lost = true;
+            continue;
+          }
+        }
+        stk[2*n] = x;
+        stk[2*n+1] = yy;
+        n++;
+      }
+    }
+  }
+  return !lost;
+}
+
+// Raster operation of bitblt() on the dots of the mask m
+static inline uint32_t blt_op(uint32_t d, uint32_t s, uint32_t m, uint8_t op) {
+  switch (op) {
+    case BLT_COPY:   return (d & ~m) | (s & m);
+    case BLT_OR:     return d | (s & m);
+    case BLT_AND:    return d & (s | ~m);
+    case BLT_XOR:    return d ^ (s & m);
+    case BLT_ANDNOT: return d & ~(s & m);
+  }
+  return d;
+}
+
+// Bits of a 1bpp line from the bit s, left justified (n: number of bits used, 1..32)
+static inline uint32_t blt_fetch(const uint8_t* p, uint32_t s, uint8_t n) {
+  uint8_t nb;
+  uint32_t v;
+
+  p += s >> 3;
+  s &= 7;
+  nb = (s + n + 7) >> 3;
+  v = (uint32_t)p[0] << 24;
+  if (nb > 1) v |= (uint32_t)p[1] << 16;
+  if (nb > 2) v |= (uint32_t)p[2] << 8;
+  if (nb > 3) v |= p[3];
+  v <<= s;
+  if (nb > 4) v |= p[4] >> (8 - s);
+  return v;
+}
+
+// VRAM word of the dots of 4 bytes (MSB = first dot) and back
+// Without byte swap the bytes are in the reverse order of a little endian word,
+// with byte swap (TNTSC SC_DMA16) the half words are.
+static inline uint32_t vram_word(uint32_t w, uint8_t bswap) {
+  return bswap ? (w >> 16) | (w << 16) : __builtin_bswap32(w);
+}
+
+// One line of bitblt(), n dots from the bit s of src (and mask) to the dot x of row
+// Dots up to a word boundary of VRAM are done a byte at a time, the middle
+// 32 dots at a time with the source funnel shifted to the dot position.
+void TTVout::blt_row(uint8_t* row, int16_t x, const uint8_t* src, const uint8_t* mask, uint16_t s, int16_t n, uint8_t op) {
+  uint8_t k, m, sh;
+  uint8_t* p;
+
+  while (n > 0) {
+    if (n >= 32 && !(x & 7) && !((uintptr_t)(row + (x >> 3)) & 3)) {
+      const uint8_t* q = src + (s >> 3);
+      const uint8_t* qm = mask ? mask + (s >> 3) : NULL;
+      uint32_t* w = (uint32_t*)(row + (x >> 3));
+      uint32_t v, mm = 0xffffffff;
+      sh = s & 7;
+      for (; n >= 32; n -= 32, x += 32, s += 32, q += 4, w++) {
+        v = ((uint32_t)q[0] << 24) | ((uint32_t)q[1] << 16) | ((uint32_t)q[2] << 8) | q[3];
+        if (sh)
+          v = (v << sh) | (q[4] >> (8 - sh));
+        if (qm) {
+          mm = ((uint32_t)qm[0] << 24) | ((uint32_t)qm[1] << 16) | ((uint32_t)qm[2] << 8) | qm[3];
+          if (sh)
+            mm = (mm << sh) | (qm[4] >> (8 - sh));
+          qm += 4;
+        }
+        *w = vram_word(blt_op(vram_word(*w, _bswap), v, mm, op), _bswap);
+      }
+      continue;
+    }
+    k = 8 - (x & 7);
+    if (k > n)
+      k = n;
+    m = (uint8_t)(0xff00 >> k) >> (x & 7);
+    if (mask)
+      m &= blt_fetch(mask, s, k) >> (24 + (x & 7));
+    p = &row[(x >> 3) ^ _bswap];
+    *p = blt_op(*p, blt_fetch(src, s, k) >> (24 + (x & 7)), m, op);
+    x += k;
+    s += k;
+    n -= k;
+  }
+}
+
+// Copy the rectangle (sx,sy)-(sx+w-1,sy+h-1) of a 1bpp image to (x,y)
+// src: image (MSB = left dot), stride: bytes per line of the image
+// op: BLT_COPY, BLT_OR, BLT_AND, BLT_XOR, BLT_ANDNOT
+// mask: image of the same layout, only the dots of its 1 bits are drawn (NULL: all)
+void TTVout::bitblt(int16_t x, int16_t y, const uint8_t* src, uint16_t stride,
+           int16_t sx, int16_t sy, int16_t w, int16_t h, uint8_t op, const uint8_t* mask) {
+  int16_t x0 = x, y0 = y;
+  uint8_t* row;
+
+  if (w <= 0 || h <= 0 || !clip_box(x, y, w, h))
+    return;
+  sx += x - x0;
+  sy += y - y0;
+  src += sy*stride;
+  if (mask)
+    mask += sy*stride;
+  row = _screen + _hres*y;
+  while (h--) {
+    blt_row(row, x, src, mask, sx, w, op);
+    row += _hres;
+    src += stride;
+    if (mask)
+      mask += stride;
+  }
+}
+
 // Bitmap drawing
+// The image at bmp+i starts with the width and the height unless they are specified.
 void TTVout::bitmap(uint16_t x, uint16_t y, const unsigned char * bmp,
            uint16_t i, uint16_t width, uint16_t lines) {
-
-  uint8_t temp, lshift, rshift, save, xtra;
-  uint16_t si = 0;
-  
-  rshift = x&7;
-  lshift = 8-rshift;
   if (width == 0) {
   	width = *(bmp + i);
     i++;
@@ -356,115 +1460,670 @@ void TTVout::bitmap(uint16_t x, uint16_t y, const unsigned char * bmp,
     lines = *(bmp + i);
     i++;
   }
-    
-  if (width&7) {
-    xtra = width&7;
-    width = width/8;
-    width++;
+  bitblt(x, y, bmp + i, (width + 7)/8, 0, 0, width, lines);
+} // end of bitmap
+
+// Copy the rectangle (sx,sy)-(sx+w-1,sy+h-1) of the bitmap src to (x,y) (w, h < 0: up to its ends)
+// src must not overlap the rectangle drawn. Lines with swapped bytes are put in order 256 dots at a time.
+void TTVout::blit(int16_t x, int16_t y, const Surface& src, int16_t sx, int16_t sy,
+                  int16_t w, int16_t h, uint8_t op) {
+  uint8_t buf[32 + 4 + 1];
+  const uint8_t* line;
+  int16_t x0, y0, d, n, b0, i;
+
+  if (w < 0) w = src.width - sx;
+  if (h < 0) h = src.height - sy;
+  if (sx < 0) { x -= sx; w += sx; sx = 0; }
+  if (sy < 0) { y -= sy; h += sy; sy = 0; }
+  if (sx + w > src.width)  w = src.width - sx;
+  if (sy + h > src.height) h = src.height - sy;
+  if (!src.bswap) {
+    bitblt(x, y, src.buf, src.stride, sx, sy, w, h, op);
+    return;
   }
-  else {
-    xtra = 8;
-    width = width/8;
+  x0 = x;
+  y0 = y;
+  if (w <= 0 || h <= 0 || !clip_box(x, y, w, h))
+    return;
+  sx += x - x0;
+  sy += y - y0;
+  line = src.buf + sy * src.stride;
+  for (; h; h--, y++, line += src.stride) {
+    for (d = 0; d < w; d += n) {
+      n = w - d < 256 ? w - d : 256;
+      b0 = (sx + d) >> 3;
+      for (i = 0; i <= ((sx + d + n - 1) >> 3) - b0; i++)
+        buf[i] = line[(b0 + i) ^ 1];
+      blt_row(_screen + _hres*y, x + d, buf, NULL, (sx + d) & 7, n, op);
+    }
   }
-  
-  for (uint8_t l = 0; l < lines; l++) {
-    si = (y + l)*_hres + x/8;
-    if (width == 1)
-      temp = 0xff >> rshift + xtra;
+}
+
+// 8 dots of a line of an image of w dots from the dot sx (MSB = dot sx, 0 outside of the image)
+static uint8_t fetch8(const uint8_t* line, int16_t w, int16_t sx) {
+  int16_t a = sx < 0 ? 0 : sx, b = sx + 8 > w ? w : sx + 8;
+
+  if (a >= b)
+    return 0;
+  return ((blt_fetch(line, a, b - a) >> 24) & (uint8_t)(0xff00 >> (b - a))) >> (a - sx);
+}
+
+// Transpose the 8x8 dots of the lines hi (0..3) and lo (4..7), MSB = left dot
+// (Hacker's Delight, by exchanging 2x2, 4x4 and 8x8 blocks of bits)
+static inline void transpose8(uint32_t& hi, uint32_t& lo) {
+  uint32_t t;
+
+  t = (hi ^ (hi >> 7)) & 0x00aa00aaUL;  hi ^= t ^ (t << 7);
+  t = (lo ^ (lo >> 7)) & 0x00aa00aaUL;  lo ^= t ^ (t << 7);
+  t = (hi ^ (hi >> 14)) & 0x0000ccccUL; hi ^= t ^ (t << 14);
+  t = (lo ^ (lo >> 14)) & 0x0000ccccUL; lo ^= t ^ (t << 14);
+  t = (hi & 0xf0f0f0f0UL) | ((lo >> 4) & 0x0f0f0f0fUL);
+  lo = ((hi << 4) & 0xf0f0f0f0UL) | (lo & 0x0f0f0f0fUL);
+  hi = t;
+}
+
+// Reverse the dots of each byte of v
+static inline uint32_t mirror8(uint32_t v) {
+  v = ((v >> 1) & 0x55555555UL) | ((v & 0x55555555UL) << 1);
+  v = ((v >> 2) & 0x33333333UL) | ((v & 0x33333333UL) << 2);
+  return ((v >> 4) & 0x0f0f0f0fUL) | ((v & 0x0f0f0f0fUL) << 4);
+}
+
+// Copy a 1bpp image of w x h dots (stride: bytes per line) to (x,y) rotated by rot
+// rot: ROT_0, ROT_90, ROT_180, ROT_270 (clockwise), | MIRROR: mirrored left-right before the
+// rotation. With ROT_90 and ROT_270 the image on the screen is h dots wide and w dots high.
+// The image is done by 8x8 blocks, each transposed and mirrored with shifts and masks,
+// 4 blocks of the screen line at a time are drawn by blt_row().
+void TTVout::bitblt_rot(int16_t x, int16_t y, const uint8_t* src, uint16_t stride,
+                        int16_t w, int16_t h, uint8_t rot, uint8_t op) {
+  bool tr = rot & 1;
+  int8_t fx = (rot & 2) ? -1 : 1, fy = ((rot + 1) & 2) ? -1 : 1;
+  int16_t cx = x, cy = y, cw = tr ? h : w, ch = tr ? w : h;
+  int16_t dx, dy, bx, sx, sy, a, b, r;
+  uint8_t buf[8][4];
+  uint32_t hi, lo, t;
+
+  if (rot & MIRROR)
+    fx = -fx;
+  if (w <= 0 || h <= 0 || !clip_box(cx, cy, cw, ch))
+    return;
+  cx -= x;
+  cy -= y;
+  for (dy = cy & ~7; dy < cy + ch; dy += 8) {
+    for (dx = cx & ~7; dx < cx + cw; dx += 32) {
+      for (bx = dx; bx < dx + 32 && bx < cx + cw; bx += 8) {
+        // Source block of the screen block (bx,dy), from its upper left dot
+        sx = (tr ? dy : bx);
+        sy = (tr ? bx : dy);
+        sx = fx > 0 ? sx : w - 8 - sx;
+        sy = fy > 0 ? sy : h - 8 - sy;
+        hi = lo = 0;
+        for (r = 0; r < 8; r++) {
+          if (sy + r < 0 || sy + r >= h)
+            continue;
+          t = fetch8(src + (sy + r) * stride, w, sx);
+          if (r < 4)
+            hi |= t << (24 - 8 * r);
+          else
+            lo |= t << (56 - 8 * r);
+        }
+        if (tr)
+          transpose8(hi, lo);
+        if (tr ? fy < 0 : fx < 0) {
+          hi = mirror8(hi);
+          lo = mirror8(lo);
+        }
+        if (tr ? fx < 0 : fy < 0) {
+          t = hi;
+          hi = __builtin_bswap32(lo);
+          lo = __builtin_bswap32(t);
+        }
+        for (r = 0; r < 8; r++)
+          buf[r][(bx - dx) >> 3] = (r < 4 ? hi >> (24 - 8 * r) : lo >> (56 - 8 * r));
+      }
+      a = dx > cx ? dx : cx;
+      b = dx + 32 < cx + cw ? dx + 32 : cx + cw;
+      for (r = 0; r < 8; r++)
+        if (dy + r >= cy && dy + r < cy + ch)
+          blt_row(_screen + _hres*(y + dy + r), x + a, buf[r], NULL, a - dx, b - a, op);
+    }
+  }
+}
+
+// bitmap() rotated by rot (ROT_0 .. ROT_270, MIRROR)
+void TTVout::bitmap_rot(int16_t x, int16_t y, const unsigned char* bmp, uint8_t rot, uint8_t op) {
+  bitblt_rot(x, y, bmp + 2, (bmp[0] + 7)/8, bmp[0], bmp[1], rot, op);
+}
+
+// Dots of a byte doubled (MSB first)
+static const uint16_t expand2_tbl[256] = {
+  0x0000, 0x0003, 0x000c, 0x000f, 0x0030, 0x0033, 0x003c, 0x003f,
+  0x00c0, 0x00c3, 0x00cc, 0x00cf, 0x00f0, 0x00f3, 0x00fc, 0x00ff,
+  0x0300, 0x0303, 0x030c, 0x030f, 0x0330, 0x0333, 0x033c, 0x033f,
+  0x03c0, 0x03c3, 0x03cc, 0x03cf, 0x03f0, 0x03f3, 0x03fc, 0x03ff,
+  0x0c00, 0x0c03, 0x0c0c, 0x0c0f, 0x0c30, 0x0c33, 0x0c3c, 0x0c3f,
+  0x0cc0, 0x0cc3, 0x0ccc, 0x0ccf, 0x0cf0, 0x0cf3, 0x0cfc, 0x0cff,
+  0x0f00, 0x0f03, 0x0f0c, 0x0f0f, 0x0f30, 0x0f33, 0x0f3c, 0x0f3f,
+  0x0fc0, 0x0fc3, 0x0fcc, 0x0fcf, 0x0ff0, 0x0ff3, 0x0ffc, 0x0fff,
+  0x3000, 0x3003, 0x300c, 0x300f, 0x3030, 0x3033, 0x303c, 0x303f,
+  0x30c0, 0x30c3, 0x30cc, 0x30cf, 0x30f0, 0x30f3, 0x30fc, 0x30ff,
+  0x3300, 0x3303, 0x330c, 0x330f, 0x3330, 0x3333, 0x333c, 0x333f,
+  0x33c0, 0x33c3, 0x33cc, 0x33cf, 0x33f0, 0x33f3, 0x33fc, 0x33ff,
+  0x3c00, 0x3c03, 0x3c0c, 0x3c0f, 0x3c30, 0x3c33, 0x3c3c, 0x3c3f,
+  0x3cc0, 0x3cc3, 0x3ccc, 0x3ccf, 0x3cf0, 0x3cf3, 0x3cfc, 0x3cff,
+  0x3f00, 0x3f03, 0x3f0c, 0x3f0f, 0x3f30, 0x3f33, 0x3f3c, 0x3f3f,
+  0x3fc0, 0x3fc3, 0x3fcc, 0x3fcf, 0x3ff0, 0x3ff3, 0x3ffc, 0x3fff,
+  0xc000, 0xc003, 0xc00c, 0xc00f, 0xc030, 0xc033, 0xc03c, 0xc03f,
+  0xc0c0, 0xc0c3, 0xc0cc, 0xc0cf, 0xc0f0, 0xc0f3, 0xc0fc, 0xc0ff,
+  0xc300, 0xc303, 0xc30c, 0xc30f, 0xc330, 0xc333, 0xc33c, 0xc33f,
+  0xc3c0, 0xc3c3, 0xc3cc, 0xc3cf, 0xc3f0, 0xc3f3, 0xc3fc, 0xc3ff,
+  0xcc00, 0xcc03, 0xcc0c, 0xcc0f, 0xcc30, 0xcc33, 0xcc3c, 0xcc3f,
+  0xccc0, 0xccc3, 0xcccc, 0xcccf, 0xccf0, 0xccf3, 0xccfc, 0xccff,
+  0xcf00, 0xcf03, 0xcf0c, 0xcf0f, 0xcf30, 0xcf33, 0xcf3c, 0xcf3f,
+  0xcfc0, 0xcfc3, 0xcfcc, 0xcfcf, 0xcff0, 0xcff3, 0xcffc, 0xcfff,
+  0xf000, 0xf003, 0xf00c, 0xf00f, 0xf030, 0xf033, 0xf03c, 0xf03f,
+  0xf0c0, 0xf0c3, 0xf0cc, 0xf0cf, 0xf0f0, 0xf0f3, 0xf0fc, 0xf0ff,
+  0xf300, 0xf303, 0xf30c, 0xf30f, 0xf330, 0xf333, 0xf33c, 0xf33f,
+  0xf3c0, 0xf3c3, 0xf3cc, 0xf3cf, 0xf3f0, 0xf3f3, 0xf3fc, 0xf3ff,
+  0xfc00, 0xfc03, 0xfc0c, 0xfc0f, 0xfc30, 0xfc33, 0xfc3c, 0xfc3f,
+  0xfcc0, 0xfcc3, 0xfccc, 0xfccf, 0xfcf0, 0xfcf3, 0xfcfc, 0xfcff,
+  0xff00, 0xff03, 0xff0c, 0xff0f, 0xff30, 0xff33, 0xff3c, 0xff3f,
+  0xffc0, 0xffc3, 0xffcc, 0xffcf, 0xfff0, 0xfff3, 0xfffc, 0xffff
+};
+
+// Dots of a nibble tripled
+static const uint16_t expand3_tbl[16] = {
+  0x000, 0x007, 0x038, 0x03f, 0x1c0, 0x1c7, 0x1f8, 0x1ff,
+  0xe00, 0xe07, 0xe38, 0xe3f, 0xfc0, 0xfc7, 0xff8, 0xfff
+};
+
+// The dots of the byte b made xs times wider to the xs bytes of p
+static inline void expand_byte(uint8_t* p, uint8_t b, uint8_t xs) {
+  uint32_t v;
+  uint8_t i, j;
+
+  switch (xs) {
+    case 1:
+      *p = b;
+      return;
+    case 2:
+      v = expand2_tbl[b];
+      break;
+    case 3:
+      v = ((uint32_t)expand3_tbl[b >> 4] << 12) | expand3_tbl[b & 15];
+      break;
+    case 4:
+      v = expand2_tbl[b];
+      v = ((uint32_t)expand2_tbl[v >> 8] << 16) | expand2_tbl[v & 0xff];
+      break;
+    default:
+      memset(p, 0, xs);
+      for (i = 0; i < 8; i++)
+        if (b & (0x80 >> i))
+          for (j = i * xs; j < (i + 1) * xs; j++)
+            p[j >> 3] |= 0x80 >> (j & 7);
+      return;
+  }
+  for (i = xs; i; i--, v >>= 8)
+    p[i - 1] = v;
+}
+
+// Copy a 1bpp image of w x h dots (stride: bytes per line) to (x,y), xs times wider and
+// ys times higher (1..16). The dots of a line are widened a source byte at a time by
+// the tables, in pieces of up to 256 dots, and each piece is drawn to ys lines.
+void TTVout::bitblt_scaled(int16_t x, int16_t y, const uint8_t* src, uint16_t stride,
+                           int16_t w, int16_t h, uint8_t xs, uint8_t ys, uint8_t op) {
+  uint8_t buf[32 + 16 + 4];   // 256 dots, one more source byte, fetch margin
+  int16_t cx = x, cy = y, cw, ch, d, n, o, sy, r, yy;
+  uint16_t sb, k;
+
+  if (w <= 0 || h <= 0 || xs < 1 || xs > 16 || ys < 1 || ys > 16)
+    return;
+  cw = w * xs;
+  ch = h * ys;
+  if (!clip_box(cx, cy, cw, ch))
+    return;
+  cx -= x;
+  cy -= y;
+  for (sy = cy / ys; sy * ys < cy + ch; sy++) {
+    const uint8_t* line = src + sy * stride;
+    for (d = cx; d < cx + cw; d += n) {
+      sb = (d / xs) >> 3;             // first source byte
+      o = d - sb * 8 * xs;            // dot d in the piece
+      n = cx + cw - d;
+      if (n > 256 - o)
+        n = 256 - o;
+      for (k = 0; k * 8 * xs < o + n; k++)
+        expand_byte(buf + k * xs, line[sb + k], xs);
+      for (r = 0; r < ys; r++) {
+        yy = sy * ys + r;
+        if (yy >= cy && yy < cy + ch)
+          blt_row(_screen + _hres*(y + yy), x + d, buf, NULL, o, n, op);
+      }
+    }
+  }
+}
+
+// bitmap() xs times wider and ys times higher
+void TTVout::bitmap_scaled(int16_t x, int16_t y, const unsigned char* bmp, uint8_t xs, uint8_t ys, uint8_t op) {
+  bitblt_scaled(x, y, bmp + 2, (bmp[0] + 7)/8, bmp[0], bmp[1], xs, ys, op);
+}
+
+// Add the sprite s on top of the others, hidden
+// image, mask: w x h dots, save: SPRITE_SAVE_SIZE(w, h) bytes for the dots under it
+void TTVout::add_sprite(Sprite* s, const uint8_t* image, const uint8_t* mask, int16_t w, int16_t h, uint8_t* save) {
+  Sprite** p = &_sprites;
+
+  s->image = image;
+  s->mask = mask;
+  s->save = save;
+  s->w = w;
+  s->h = h;
+  s->x = s->y = 0;
+  s->next = NULL;
+  s->sw = 0;
+  s->shown = false;
+  s->redraw = false;
+  while (*p)
+    p = &(*p)->next;
+  *p = s;
+}
+
+// Hide the sprite s and forget it
+void TTVout::remove_sprite(Sprite* s) {
+  Sprite** p = &_sprites;
+
+  hide_sprite(s);
+  while (*p && *p != s)
+    p = &(*p)->next;
+  if (*p)
+    *p = s->next;
+}
+
+// Save the dots under the sprite s and draw it (the clip rectangle applies)
+// Whole bytes of VRAM are saved, in the order of the dots.
+void TTVout::sprite_save(Sprite* s) {
+  int16_t x = s->x, y = s->y, w = s->w, h = s->h, nb, i;
+  uint8_t* row;
+  uint8_t* q = s->save;
+
+  s->sw = 0;
+  if (!clip_box(x, y, w, h))
+    return;
+  s->sx = x;
+  s->sy = y;
+  s->sw = w;
+  s->sh = h;
+  nb = ((x + w - 1) >> 3) - (x >> 3) + 1;
+  x >>= 3;
+  row = _screen + _hres*y;
+  for (; h; h--, row += _hres, q += nb) {
+    if (!_bswap)
+      memcpy(q, row + x, nb);
     else
-      temp = 0;
-    save = _screen[si];
-    _screen[si] &= ((0xff << lshift) | temp);
-  	temp = *(bmp + i++);
-    _screen[si++] |= temp >> rshift;
-    for ( uint16_t b = i + width-1; i < b; i++) {
-      save = _screen[si];
-      _screen[si] = temp << lshift;
-    	temp = *(bmp + i);
-      _screen[si++] |= temp >> rshift;
-    }
-    if (rshift + xtra < 8)
-      _screen[si-1] |= (save & (0xff >> rshift + xtra)); //test me!!!
-    if (rshift + xtra - 8 > 0)
-      _screen[si] &= (0xff >> rshift + xtra - 8);
-    _screen[si] |= temp << lshift;
+      for (i = 0; i < nb; i++)
+        q[i] = row[(x + i) ^ 1];
   }
-} // end of bitmap
+  bitblt(s->x, s->y, s->image, (s->w + 7)/8, 0, 0, s->w, s->h, BLT_COPY, s->mask);
+}
+
+// Put the saved dots of the sprite s back (only the dots of the rectangle in the end bytes)
+void TTVout::sprite_restore(Sprite* s) {
+  int16_t nb, h, i;
+  uint8_t lm, rm;
+  uint8_t* row;
+  uint8_t* p;
+  const uint8_t* q = s->save;
+
+  if (!s->sw)
+    return;
+  nb = ((s->sx + s->sw - 1) >> 3) - (s->sx >> 3) + 1;
+  lm = 0xff >> (s->sx & 7);
+  rm = 0xff << (7 - ((s->sx + s->sw - 1) & 7));
+  if (nb == 1)
+    lm &= rm;
+  row = _screen + _hres*s->sy;
+  for (h = s->sh; h; h--, row += _hres, q += nb) {
+    i = s->sx >> 3;
+    p = &row[i ^ _bswap];
+    *p = (*p & ~lm) | (q[0] & lm);
+    if (nb == 1)
+      continue;
+    if (!_bswap)
+      memcpy(row + i + 1, q + 1, nb - 2);
+    else
+      for (i = 1; i < nb - 1; i++)
+        row[((s->sx >> 3) + i) ^ 1] = q[i];
+    p = &row[((s->sx >> 3) + nb - 1) ^ _bswap];
+    *p = (*p & ~rm) | (q[nb - 1] & rm);
+  }
+  s->sw = 0;
+}
+
+// Restore the marked sprites from the top down to s
+void TTVout::sprite_unwind(Sprite* s) {
+  if (!s)
+    return;
+  sprite_unwind(s->next);
+  if (s->redraw)
+    sprite_restore(s);
+}
+
+static inline bool box_overlap(int16_t x0, int16_t y0, int16_t w0, int16_t h0,
+                               int16_t x1, int16_t y1, int16_t w1, int16_t h1) {
+  return w0 > 0 && w1 > 0 && x0 < x1 + w1 && x1 < x0 + w0 && y0 < y1 + h1 && y1 < y0 + h0;
+}
+
+// Move the sprite s to (x,y), shown or hidden
+// s and the sprites above it that overlap its old or new place (directly or through
+// each other) are taken off from the top down and drawn again from the bottom up,
+// the other sprites and the rest of the screen are not touched.
+void TTVout::sprite_update(Sprite* s, bool show, int16_t x, int16_t y) {
+  int16_t nx = x, ny = y, nw = s->w, nh = s->h;
+  Sprite* t;
+  Sprite* u;
+
+  if (!show || !clip_box(nx, ny, nw, nh))
+    nw = 0;
+  s->redraw = true;
+  for (t = s->next; t; t = t->next) {
+    t->redraw = false;
+    if (!t->shown || !t->sw)
+      continue;
+    if (box_overlap(t->sx, t->sy, t->sw, t->sh, nx, ny, nw, nh))
+      t->redraw = true;
+    for (u = s; u != t && !t->redraw; u = u->next)
+      if (u->redraw && box_overlap(t->sx, t->sy, t->sw, t->sh, u->sx, u->sy, u->sw, u->sh))
+        t->redraw = true;
+  }
+  sprite_unwind(s);
+  s->x = x;
+  s->y = y;
+  s->shown = show;
+  for (t = s; t; t = t->next)
+    if (t->redraw) {
+      t->redraw = false;
+      if (t->shown)
+        sprite_save(t);
+    }
+}
+
+// Units (32 bit words or bytes) of a VRAM line in dot order
+struct VramWords {
+  enum { BITS = 32 };
+  uint32_t* p;
+  uint8_t bs;
+  uint32_t get(int16_t i) const { return vram_word(p[i], bs); }
+  void set(int16_t i, uint32_t v) const { p[i] = vram_word(v, bs); }
+};
+struct VramBytes {
+  enum { BITS = 8 };
+  uint8_t* p;
+  uint8_t bs;
+  uint32_t get(int16_t i) const { return p[i ^ bs]; }
+  void set(int16_t i, uint32_t v) const { p[i ^ bs] = v; }
+};
+
+// Mask of the dots a..b-1 in the unit k (MSB = first dot)
+template <class R> static inline uint32_t unit_mask(int16_t k, int16_t a, int16_t b) {
+  int16_t lo = a - k*R::BITS, hi = b - k*R::BITS;
+  if (lo < 0) lo = 0;
+  if (hi > R::BITS) hi = R::BITS;
+  if (lo >= hi) return 0;
+  return (0xffffffffUL >> (32 - (hi - lo))) << (R::BITS - hi);
+}
+
+// Unit j of src masked to the dots x0..x1-1 (m0, m1: masks of the units k0 and k1)
+template <class R> static inline uint32_t move_fetch(const R& src, int16_t j, int16_t k0, int16_t k1,
+           uint32_t m0, uint32_t m1) {
+  uint32_t u;
+  if (j < k0 || j > k1)
+    return 0;
+  u = src.get(j);
+  if (j == k0) u &= m0;
+  if (j == k1) u &= m1;
+  return u;
+}
+
+// Unit k of dst, only the dots of m if it is the unit k0 or k1
+template <class R> static inline void move_store(const R& dst, int16_t k, int16_t k0, int16_t k1,
+           uint32_t m0, uint32_t m1, uint32_t v) {
+  uint32_t m = (k == k0 ? m0 : 0xffffffffUL) & (k == k1 ? m1 : 0xffffffffUL);
+  dst.set(k, (dst.get(k) & ~m) | (v & m));
+}
+
+// n whole units of move_dots(): unit k+i of dst gets the dots sh.. of the units
+// j+i and j+i+1 of src, in increasing order forwards and decreasing backwards
+template <class R> static inline void move_units(const R& dst, const R& src, int16_t k, int16_t j,
+           int16_t n, uint8_t sh, bool fwd) {
+  const int16_t B = R::BITS;
+  int16_t i;
+  if (fwd)
+    for (i = 0; i < n; i++)
+      dst.set(k + i, (src.get(j + i) << sh) | ((src.get(j + i + 1) >> 1) >> (B - 1 - sh)));
+  else
+    for (i = n - 1; i >= 0; i--)
+      dst.set(k + i, (src.get(j + i) << sh) | ((src.get(j + i + 1) >> 1) >> (B - 1 - sh)));
+}
+
+// Words of a line by pointers, the order of the bytes is a constant
+// (two words a loop, shifts by sh 1..31)
+template <uint8_t BS> static void funnel_words(uint32_t* d, const uint32_t* s, int16_t n, uint8_t sh, bool fwd) {
+  uint8_t rs = 32 - sh;
+  uint32_t u, v, w;
+  if (!sh) {
+    memmove(d, s, n * 4);
+    return;
+  }
+  if (fwd) {
+    u = vram_word(s[0], BS);
+    for (; n >= 2; n -= 2, s += 2, d += 2, u = w) {
+      v = vram_word(s[1], BS);
+      w = vram_word(s[2], BS);
+      d[0] = vram_word((u << sh) | (v >> rs), BS);
+      d[1] = vram_word((v << sh) | (w >> rs), BS);
+    }
+    if (n)
+      d[0] = vram_word((u << sh) | (vram_word(s[1], BS) >> rs), BS);
+  } else {
+    d += n;
+    s += n;
+    w = vram_word(s[0], BS);
+    for (; n >= 2; n -= 2, s -= 2, d -= 2, w = u) {
+      v = vram_word(s[-1], BS);
+      u = vram_word(s[-2], BS);
+      d[-1] = vram_word((v << sh) | (w >> rs), BS);
+      d[-2] = vram_word((u << sh) | (v >> rs), BS);
+    }
+    if (n)
+      d[-1] = vram_word((vram_word(s[-1], BS) << sh) | (w >> rs), BS);
+  }
+}
+
+// h lines of wl whole words from p as one run of words: the dot p gets the dot p+d,
+// then the dots moved over the ends of the lines are cleared
+template <uint8_t BS> static void shift_words(uint32_t* p, int16_t wl, int16_t h, int16_t d) {
+  int16_t n = wl*h, q, e = d > 0 ? d : -d;
+  uint8_t sh;
+  uint32_t m;
+  if (d > 0) {
+    q = d / 32;
+    sh = d % 32;
+    funnel_words<BS>(p, p + q, n - q - 1, sh, true);
+    p[n - q - 1] = vram_word(vram_word(p[n - 1], BS) << sh, BS);
+    m = vram_word(0xffffffffUL << sh, BS);
+  } else {
+    q = (31 - d) / 32;
+    sh = q*32 + d;
+    funnel_words<BS>(p + q, p, n - q, sh, false);
+    p[q - 1] = vram_word((vram_word(p[0], BS) >> 1) >> (31 - sh), BS);
+    m = vram_word(0xffffffffUL >> (e % 32), BS);
+  }
+  q = e / 32;                                // whole words to clear
+  for (; h; h--, p += wl)
+    if (d > 0) {
+      if (q)
+        memset(p + wl - q, 0, q * 4);
+      p[wl - 1 - q] &= m;
+    } else {
+      if (q)
+        memset(p, 0, q * 4);
+      p[q] &= m;
+    }
+}
+
+static inline void move_units(const VramWords& dst, const VramWords& src, int16_t k, int16_t j,
+           int16_t n, uint8_t sh, bool fwd) {
+  if (dst.bs)
+    funnel_words<1>(dst.p + k, src.p + j, n, sh, fwd);
+  else
+    funnel_words<0>(dst.p + k, src.p + j, n, sh, fwd);
+}
+
+// Move the dots x0..x1-1 of a line: the dot p of dst gets the dot p+d of src,
+// the dots whose source is outside x0..x1-1 are cleared. dst may be src.
+// The units of src masked to x0..x1-1 are funnel shifted to the units of dst,
+// only the first and the last units are masked.
+template <class R> static void move_dots(const R& dst, const R& src, int16_t x0, int16_t x1, int16_t d) {
+  const int16_t B = R::BITS;
+  int16_t k0 = x0 / B, k1 = (x1 - 1) / B, k, j, q;
+  uint32_t m0 = unit_mask<R>(k0, x0, x1), m1 = unit_mask<R>(k1, x0, x1);
+  uint32_t u, v;
+  uint8_t sh;
+
+  q = d >= 0 ? d / B : -((B - 1 - d) / B);   // units and dots of the distance
+  sh = d - q*B;                              // (v >> 1) >> (B - 1 - sh): v >> (B - sh), 0 for sh 0
+  if (d >= 0) {
+    // Forwards, the source is at or after the destination
+    j = k0 + q;
+    u = move_fetch(src, j, k0, k1, m0, m1);
+    v = move_fetch(src, j + 1, k0, k1, m0, m1);
+    move_store(dst, k0, k0, k1, m0, m1, (u << sh) | ((v >> 1) >> (B - 1 - sh)));
+    k = k0 + 1;
+    j++;
+    if (k < k1 - q - 1) {
+      move_units(dst, src, k, j, k1 - q - 1 - k, sh, true);
+      j += k1 - q - 1 - k;
+      k = k1 - q - 1;
+      v = src.get(j);
+    }
+    for (u = v; k <= k1; k++, j++, u = v) {
+      v = move_fetch(src, j + 1, k0, k1, m0, m1);
+      move_store(dst, k, k0, k1, m0, m1, (u << sh) | ((v >> 1) >> (B - 1 - sh)));
+    }
+  } else {
+    // Backwards, the source is before the destination
+    j = k1 + q;
+    v = move_fetch(src, j + 1, k0, k1, m0, m1);
+    u = move_fetch(src, j, k0, k1, m0, m1);
+    move_store(dst, k1, k0, k1, m0, m1, (u << sh) | ((v >> 1) >> (B - 1 - sh)));
+    k = k1 - 1;
+    j--;
+    if (k > k0 - q) {
+      move_units(dst, src, k0 - q + 1, k0 + 1, k - (k0 - q), sh, false);
+      j = k0;
+      k = k0 - q;
+      u = src.get(j + 1);
+    }
+    for (v = u; k >= k0; k--, j--, v = u) {
+      u = move_fetch(src, j, k0, k1, m0, m1);
+      move_store(dst, k, k0, k1, m0, m1, (u << sh) | ((v >> 1) >> (B - 1 - sh)));
+    }
+  }
+}
+
+// Move the dots x0..x1-1 of a line (see move_dots())
+// Whole bytes are moved by memmove(), otherwise 32 bits at a time on
+// word aligned lines. Only the words wholly inside of the line are used,
+// the dots after them are moved by bytes (by bytes only if d is not 0).
+void TTVout::move_span(uint8_t* dst, uint8_t* src, int16_t x0, int16_t x1, int16_t d) {
+  uint8_t g = _bswap ? 16 : 8;               // whole half words when swapped
+  int16_t xw = (_hres & ~3) * 8;             // end of the words inside of the line
+  if (!(d % g) && !(x0 % g) && !(x1 % g)) {
+    if (d >= 0) {
+      memmove(dst + x0/8, src + (x0 + d)/8, (x1 - x0 - d)/8);
+      if (d)
+        rop_span(dst, x1 - d, x1, ROP_CLEAR, 0xff);
+    } else {
+      memmove(dst + (x0 - d)/8, src + x0/8, (x1 - x0 + d)/8);
+      rop_span(dst, x0, x0 - d, ROP_CLEAR, 0xff);
+    }
+  } else if (!(((uintptr_t)dst | (uintptr_t)src) & 3) && (x1 <= xw || !d)) {
+    VramWords vd = { (uint32_t*)dst, _bswap }, vs = { (uint32_t*)src, _bswap };
+    VramBytes bd = { dst, _bswap }, bs = { src, _bswap };
+    if (x0 < xw)
+      move_dots(vd, vs, x0, x1 < xw ? x1 : xw, d);
+    if (x1 > xw)
+      move_dots(bd, bs, x0 > xw ? x0 : xw, x1, 0);
+  } else {
+    VramBytes vd = { dst, _bswap }, vs = { src, _bswap };
+    move_dots(vd, vs, x0, x1, d);
+  }
+}
 
 // Scroll the screen
 void TTVout::shift(uint8_t distance, uint8_t direction) {
-  uint8_t * src;
-  uint8_t * dst;
-  uint8_t * end;
-  uint8_t shift;
-  uint8_t tmp;
+  shift_rect(0, 0, _width, _vres, distance, direction);
+}
+
+// Scroll a rectangle of the screen, the exposed dots are cleared
+// (the clip rectangle is ignored)
+void TTVout::shift_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t distance, uint8_t direction) {
+  uint8_t* row;
+  int16_t i, n;
+
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width) w = _width - x;
+  if (y + h > _vres)  h = _vres - y;
+  if (w <= 0 || h <= 0 || distance == 0)
+    return;
+  if (distance >= ((direction == UP || direction == DOWN) ? h : w)) {
+    for (row = _screen + _hres*y; h; h--, row += _hres)
+      rop_span(row, x, x + w, ROP_CLEAR, 0xff);
+    return;
+  }
+  n = h - distance;
   switch(direction) {
     case UP:
-      dst = _screen;
-      src = _screen + distance*_hres;
-      end = _screen + _vres*_hres;
-      while (src <  end) {
-        *dst = *src;
-        *src = 0;
-        dst++;
-        src++;
+      if (w == _width) {
+        // Whole lines are a block
+        memmove(_screen + _hres*y, _screen + _hres*(y + distance), n*_hres);
+        memset(_screen + _hres*(y + n), 0, distance*_hres);
+        break;
       }
+      row = _screen + _hres*y;
+      for (i = 0; i < n; i++, row += _hres)
+        move_span(row, row + distance*_hres, x, x + w, 0);
+      for (; i < h; i++, row += _hres)
+        rop_span(row, x, x + w, ROP_CLEAR, 0xff);
       break;
     case DOWN:
-      dst = _screen + _vres*_hres;
-      src = dst - distance*_hres;
-      end = _screen;
-        
-      while (src >= end) {
-        *dst = *src;
-        *src = 0;
-        dst--;
-        src--;
+      if (w == _width) {
+        memmove(_screen + _hres*(y + distance), _screen + _hres*y, n*_hres);
+        memset(_screen + _hres*y, 0, distance*_hres);
+        break;
       }
+      row = _screen + _hres*(y + h - 1);
+      for (i = 0; i < n; i++, row -= _hres)
+        move_span(row, row - distance*_hres, x, x + w, 0);
+      for (; i < h; i++, row -= _hres)
+        rop_span(row, x, x + w, ROP_CLEAR, 0xff);
       break;
     case LEFT:
-      shift = distance & 7;
-      
-      for (uint8_t line = 0; line < _vres; line++) {
-        dst = _screen + _hres*line;
-        src = dst + distance/8;
-        end = dst + _hres-2;
-        while (src <= end) {
-          tmp = 0;
-          tmp = *src << shift;
-          *src = 0;
-          src++;
-          tmp |= *src >> (8 - shift);
-          *dst = tmp;
-          dst++;
-        }
-        tmp = 0;
-        tmp = *src << shift;
-        *src = 0;
-        *dst = tmp;
-      }
-      break;
     case RIGHT:
-      shift = distance & 7;
-      
-      for (uint8_t line = 0; line < _vres; line++) {
-        dst = _screen + _hres-1 + _hres*line;
-        src = dst - distance/8;
-        end = dst - _hres+2;
-        while (src >= end) {
-          tmp = 0;
-          tmp = *src >> shift;
-          *src = 0;
-          src--;
-          tmp |= *src << (8 - shift);
-          *dst = tmp;
-          dst--;
-        }
-        tmp = 0;
-        tmp = *src >> shift;
-        *src = 0;
-        *dst = tmp;
+      row = _screen + _hres*y;
+      n = direction == LEFT ? distance : -(int16_t)distance;
+      if (w == _width && _hres*8 == _width && !(_hres & 3) && !((uintptr_t)_screen & 3)) {
+        // Lines of whole words are one run of words
+        if (_bswap)
+          shift_words<1>((uint32_t*)row, _hres/4, h, n);
+        else
+          shift_words<0>((uint32_t*)row, _hres/4, h, n);
+        break;
       }
+      for (i = 0; i < h; i++, row += _hres)
+        move_span(row, row, x, x + w, n);
       break;
   }
 } // end of shift
@@ -475,27 +2134,399 @@ void TTVout::select_font(const unsigned char * f) {
   _font = f;
 }
 
+// Cache of pre-shifted glyphs
+// A slot holds the lines of one glyph (up to 8 dots wide) shifted to one dot
+// position in the byte, so that printing it is two masked writes per line.
+// Slots are made when a character is printed at a new position (phase) and
+// the least recently used one is reused when the cache is full.
+#define GCACHE_HASH   32    // number of hash chains
+#define GCACHE_NONE   0xff  // end of a hash chain
+#define GCACHE_ALIGN  (sizeof(void*) - 1)   // the slots are aligned for their font pointer
+
+struct GlyphSlot {
+  const unsigned char* font;  // font of the glyph (NULL: empty slot)
+  uint16_t used;              // time stamp of the last use
+  uint8_t  code;              // character code
+  uint8_t  phase;             // dot position in the byte (x & 7)
+  uint8_t  next;              // next slot of the hash chain
+  uint8_t  reserve;
+  uint16_t bits[1];           // lines of the glyph (MSB = dot 0 of the byte)
+};
+
+struct GlyphCache {
+  uint8_t  chars[32];         // bitmap of the character codes to cache
+  uint8_t  hash[GCACHE_HASH]; // first slot of each hash chain
+  uint16_t clock;             // time stamp of the last use
+  uint16_t slot_size;         // bytes of a slot
+  uint8_t  slots;             // number of slots
+  uint8_t  rows;              // lines of a slot
+};
+
+#define GCACHE_HEAD   ((sizeof(GlyphCache) + GCACHE_ALIGN) & ~GCACHE_ALIGN)  // bytes before the slots
+
+static inline GlyphSlot* gcache_slot(GlyphCache* gc, uint8_t i) {
+  return (GlyphSlot*)((uint8_t*)gc + GCACHE_HEAD + gc->slot_size * i);
+}
+
+static inline uint8_t gcache_hash(uint8_t c, uint8_t phase) {
+  return (c * 9 + phase) & (GCACHE_HASH - 1);
+}
+
+// Use buf (size bytes) as the cache of the characters of chars (NULL: all)
+// rows: maximum height of the cached glyphs
+// print_char () and the strings of print () / write () without a text style use it.
+// buf NULL stops using the cache. Returns false if no slot fits in size.
+bool TTVout::set_glyph_cache(void* buf, uint16_t size, const char* chars, uint8_t rows) {
+  GlyphCache* gc = (GlyphCache*)(((uintptr_t)buf + GCACHE_ALIGN) & ~(uintptr_t)GCACHE_ALIGN);
+  uint16_t slot_size = (sizeof(GlyphSlot) - sizeof(uint16_t) + rows * sizeof(uint16_t) + GCACHE_ALIGN) & ~GCACHE_ALIGN;
+  uint16_t n;
+
+  _gcache = NULL;
+  if (!buf || !rows || size < ((uint8_t*)gc - (uint8_t*)buf) + GCACHE_HEAD + slot_size)
+    return false;
+  n = (size - ((uint8_t*)gc - (uint8_t*)buf) - GCACHE_HEAD) / slot_size;
+  gc->slots = n < GCACHE_NONE ? n : GCACHE_NONE;
+  gc->rows = rows;
+  gc->slot_size = slot_size;
+  memset(gc->chars, chars ? 0 : 0xff, sizeof(gc->chars));
+  if (chars)
+    while (*chars) {
+      gc->chars[(uint8_t)*chars >> 3] |= 1 << (*chars & 7);
+      chars++;
+    }
+  _gcache = gc;
+  flush_glyph_cache();
+  return true;
+}
+
+void TTVout::flush_glyph_cache() {
+  GlyphCache* gc = _gcache;
+
+  if (!gc)
+    return;
+  memset(gc->hash, GCACHE_NONE, sizeof(gc->hash));
+  for (uint8_t i = 0; i < gc->slots; i++)
+    gcache_slot(gc, i)->font = NULL;
+  gc->clock = 0;
+}
+
+// Print the character c by the cache (false: not cacheable, use bitblt())
+bool TTVout::cached_char(uint16_t x, uint16_t y, uint8_t c) {
+  GlyphCache* gc = _gcache;
+  GlyphSlot* sl;
+  uint8_t w = *_font, h = *(_font+1), ph = x & 7, i, v;
+  uint8_t* hp;
+  uint8_t* row;
+  uint16_t m;
+
+  if (w > 8 || h > gc->rows || !(gc->chars[c >> 3] & (1 << (c & 7)))
+      || (int16_t)x < _clip_x0 || (int16_t)(x + w - 1) > _clip_x1
+      || (int16_t)y < _clip_y0 || (int16_t)(y + h - 1) > _clip_y1)
+    return false;
+
+  // Look for the slot
+  hp = &gc->hash[gcache_hash(c, ph)];
+  for (i = *hp; i != GCACHE_NONE; i = sl->next) {
+    sl = gcache_slot(gc, i);
+    if (sl->code == c && sl->phase == ph && sl->font == _font)
+      break;
+  }
+
+  // Not cached, make it in the empty or least recently used slot
+  if (i == GCACHE_NONE) {
+    const unsigned char* g = _font + 3 + (uint8_t)(c - *(_font+2)) * h;
+    uint8_t mw = 0xff << (8 - w);
+    uint16_t age = 0;
+    for (v = 0; v < gc->slots; v++) {
+      GlyphSlot* s = gcache_slot(gc, v);
+      if (!s->font) {
+        i = v;
+        break;
+      }
+      if (i == GCACHE_NONE || (uint16_t)(gc->clock - s->used) > age) {
+        age = gc->clock - s->used;
+        i = v;
+      }
+    }
+    sl = gcache_slot(gc, i);
+    if (sl->font) {
+      uint8_t* q = &gc->hash[gcache_hash(sl->code, sl->phase)];
+      while (*q != i)
+        q = &gcache_slot(gc, *q)->next;
+      *q = sl->next;
+    }
+    sl->font = _font;
+    sl->code = c;
+    sl->phase = ph;
+    for (v = 0; v < h; v++)
+      sl->bits[v] = ((uint16_t)(g[v] & mw) << 8) >> ph;
+    sl->next = *hp;
+    *hp = i;
+  }
+  sl->used = ++gc->clock;
+
+  // Draw it
+  m = (uint16_t)(0xff00 << (8 - w)) >> ph;
+  row = _screen + _hres*y;
+  x >>= 3;
+  for (v = 0; v < h; v++, row += _hres) {
+    uint8_t* p = &row[x ^ _bswap];
+    *p = (*p & ~(m >> 8)) | (sl->bits[v] >> 8);
+    if (m & 0xff) {
+      p = &row[(x + 1) ^ _bswap];
+      *p = (*p & ~m) | sl->bits[v];
+    }
+  }
+  return true;
+}
+
+// Rotate the text by rot (ROT_0 .. ROT_270, MIRROR), print() draws on the rotated screen
+// With ROT_90 the lines go down the screen from the right end, and so on.
+// The cursor goes to the upper left of the rotated screen. Text styles are not drawn rotated.
+void TTVout::set_text_rotation(uint8_t rot) {
+  _text_rot = rot & (ROT_270 | MIRROR);
+  _cursor_x = 0;
+  _cursor_y = 0;
+}
+
 // Display characters
+// (x,y) is on the screen of the text rotation, a rotated glyph is drawn by bitblt_rot().
 void TTVout::print_char(uint16_t x, uint16_t y, uint8_t c) {
+  uint8_t bw = (*_font + 7)/8;   // bytes per line of a glyph
+  if (_text_rot) {
+    uint8_t fw = *_font, fh = *(_font+1), rot = _text_rot & ROT_270;
+    int16_t px = (_text_rot & MIRROR) ? text_width() - x - fw : x, py = y;
+    int16_t w = text_width(), h = text_height(), t;
+    // Upper left of the glyph box on the screen
+    if (rot == ROT_90) {
+      t = px;
+      px = h - py - fh;
+      py = t;
+    } else if (rot == ROT_180) {
+      px = w - px - fw;
+      py = h - py - fh;
+    } else if (rot == ROT_270) {
+      t = px;
+      px = py;
+      py = w - t - fw;
+    }
+    c -= *(_font+2);
+    bitblt_rot(px, py, _font + 3 + c * *(_font+1) * bw, bw, fw, fh, _text_rot);
+    return;
+  }
+  if (_text_style && *_font <= 32) {
+    text_run(x, y, &c, 1);
+    return;
+  }
+  if (_gcache && cached_char(x, y, c))
+    return;
 	c -= *(_font+2);
-  bitmap(x, y, _font , c* *(_font+1) + 3, *_font , *(_font+1) );
+  bitblt(x, y, _font + 3 + c * *(_font+1) * bw, bw, 0, 0, *_font, *(_font+1));
+}
+
+// Display the character c xs times wider and ys times higher (1..16)
+void TTVout::print_char(uint16_t x, uint16_t y, uint8_t c, uint8_t xs, uint8_t ys) {
+  uint8_t bw = (*_font + 7)/8;
+
+  c -= *(_font+2);
+  bitblt_scaled(x, y, _font + 3 + c * *(_font+1) * bw, bw, *_font, *(_font+1), xs, ys);
 }
 
 void TTVout::inc_txtline() {
-  if (_cursor_y >= (_vres - *(_font+1)))
-    shift(*(_font+1),UP);
+  static const uint8_t up[4] = { UP, RIGHT, DOWN, LEFT };  // UP of the text rotations
+  if (_cursor_y >= (text_height() - *(_font+1)))
+    shift(*(_font+1),up[_text_rot & ROT_270]);
   else
     _cursor_y += *(_font+1);
 }
 
+// Dots of one font line of the characters of a run, a VRAM unit at a time
+// The glyph lines are gathered in an accumulator from the unit k (x: dot of the first character).
+template <class R> struct GlyphBits {
+  const uint8_t* s;           // next character
+  const unsigned char* font;
+  const unsigned char* g;     // line of the first glyph
+  uint16_t gs;                // bytes per glyph
+  uint32_t fm;                // mask of the glyph width
+  int16_t  x, x1;             // dot of the next character, end of the characters
+  uint8_t  fw, nb;            // glyph width, dots in the accumulator
+  uint64_t acc;
+
+  // r: font line (outside of the font: blank), x1: end of the characters to use
+  GlyphBits(const uint8_t* s, const unsigned char* font, int16_t r, int16_t k, int16_t x, int16_t x1)
+    : s(s), font(font), x(x), x1(x1), fw(font[0]), acc(0) {
+    uint8_t bw = (fw + 7)/8;
+    gs = font[1] * bw;
+    g = font + 3 + r * bw;
+    fm = fw < 32 ? ~(0xffffffffUL >> fw) : 0xffffffffUL;
+    nb = x - k * R::BITS;
+    if (r < 0 || r >= font[1])
+      this->x = x1;
+  }
+  uint32_t next() {
+    uint32_t v;
+    while (nb < R::BITS && x < x1) {
+      acc |= (uint64_t)(blt_fetch(g + (uint8_t)(*s++ - font[2]) * gs, 0, fw) & fm) << (32 - nb);
+      nb += fw;
+      x += fw;
+    }
+    v = acc >> (64 - R::BITS);
+    acc <<= R::BITS;
+    nb = nb > R::BITS ? nb - R::BITS : 0;
+    return v;
+  }
+};
+
+// Write the dots v of the mask m to the unit k, the other dots of cover are cleared
+template <class R> static inline void text_put(const R& dst, int16_t k, uint32_t m, uint32_t cover, uint32_t v) {
+  const uint32_t full = 0xffffffffUL >> (32 - R::BITS);
+  cover &= m;
+  if (cover == full)
+    dst.set(k, v);
+  else if (cover)
+    dst.set(k, (dst.get(k) & ~cover) | (v & m));
+}
+
+// One VRAM line (font line r) of the characters s from the dot x, only the dots x0..x1-1 are written
+// TEXT_OUTLINE: the glyphs dilated by one dot (3x3) are cleared, TEXT_SHADOW: the glyphs moved
+// by one dot to the lower right are cleared. Both from the neighbouring font lines by shifts and ORs.
+template <class R> static void text_line(const R& dst, int16_t x, int16_t x0, int16_t x1, int16_t xe,
+                                         const uint8_t* s, const unsigned char* font, int16_t r, uint8_t style) {
+  const uint32_t full = 0xffffffffUL >> (32 - R::BITS);
+  int16_t k = (x < x0 ? x : x0) / R::BITS, kl = (x1 - 1) / R::BITS;
+  GlyphBits<R> b(s, font, r, k, x, xe);
+  GlyphBits<R> u(s, font, r - 1, k, x, xe);
+  uint32_t cb, cu, pu = 0;
+
+  if (style == TEXT_OUTLINE) {
+    GlyphBits<R> d(s, font, r + 1, k, x, xe);
+    uint32_t cv, nv, nb, pv = 0;
+    cb = b.next();
+    cv = cb | u.next() | d.next();
+    for (; k <= kl; k++) {
+      nb = b.next();
+      nv = nb | u.next() | d.next();
+      text_put(dst, k, unit_mask<R>(k, x0, x1),
+               (cv | (cv >> 1) | (cv << 1) | (pv << (R::BITS - 1)) | (nv >> (R::BITS - 1))) & full, cb);
+      pv = cv;
+      cv = nv;
+      cb = nb;
+    }
+  } else if (style == TEXT_SHADOW) {
+    for (; k <= kl; k++) {
+      cb = b.next();
+      cu = u.next();
+      text_put(dst, k, unit_mask<R>(k, x0, x1), (cb | (cu >> 1) | (pu << (R::BITS - 1))) & full, cb);
+      pu = cu;
+    }
+  } else {
+    for (; k <= kl; k++)
+      text_put(dst, k, unit_mask<R>(k, x0, x1), full, b.next());
+  }
+}
+
+// Draw the n characters s from (x,y) (no control codes, no wrap)
+// With an outline the dots around the glyphs (one dot) are cleared,
+// with a shadow the dots below and right of them.
+void TTVout::text_run(uint16_t x, uint16_t y, const uint8_t* s, uint16_t n) {
+  uint8_t fw = *_font;
+  uint16_t j, k;
+
+  if (fw > 32 || _text_rot || (n == 1 && !_text_style)) {
+    while (n--) {
+      print_char(x, y, *s++);
+      x += fw;
+    }
+    return;
+  }
+  if (_gcache && fw <= 8 && !_text_style) {
+    // Characters of the glyph cache one at a time, the others by runs between them
+    for (j = 0; j < n; j = k + 1) {
+      for (k = j; k < n && !cached_char(x + k * fw, y, s[k]); k++)
+        ;
+      if (k > j)
+        text_lines(x + j * fw, y, s + j, k - j);
+    }
+    return;
+  }
+  text_lines(x, y, s, n);
+}
+
+// Draw the n characters s from (x,y) a VRAM line at a time
+void TTVout::text_lines(uint16_t x, uint16_t y, const uint8_t* s, uint16_t n) {
+  uint8_t fw = *_font, h = *(_font+1), e = _text_style ? 1 : 0;
+  int16_t x0 = x - (_text_style == TEXT_OUTLINE), x1 = x + n * fw, xe = x1, j, r, yy, xw;
+  uint8_t* row;
+
+  x1 += e;
+  if (x0 < _clip_x0) x0 = _clip_x0;
+  if (x1 > _clip_x1 + 1) x1 = _clip_x1 + 1;
+  if (x0 >= x1)
+    return;
+  if (xe > x1 + 1)
+    xe = x1 + 1;
+  j = x0 - e > (int16_t)x ? (x0 - e - (int16_t)x) / fw : 0;    // first character used
+  s += j;
+  x += j * fw;
+  for (r = -(_text_style == TEXT_OUTLINE); r < h + e; r++) {
+    yy = y + r;
+    if (yy < _clip_y0 || yy > _clip_y1)
+      continue;
+    row = _screen + _hres*yy;
+    xw = (uintptr_t)row & 3 ? x0 : (_hres & ~3) * 8;   // end of the words inside of the line
+    if (xw < x0)
+      xw = x0;
+    if (xw > x0) {
+      VramWords d = { (uint32_t*)row, _bswap };
+      text_line(d, x, x0, x1 < xw ? x1 : xw, xe, s, _font, r, _text_style);
+    }
+    if (xw < x1) {
+      // Dots after the words by bytes, from the character before the dot xw
+      VramBytes d = { row, _bswap };
+      j = xw - e > (int16_t)x ? (xw - e - (int16_t)x) / fw : 0;
+      text_line(d, x + j * fw, xw, x1, xe, s + j, _font, r, _text_style);
+    }
+  }
+}
+
+// write() of n characters, the characters up to a control code or the wrap are drawn at once
+void TTVout::write_text(const uint8_t* s, uint16_t n) {
+  int16_t lim = text_width() - *_font;
+  uint16_t k, cx;
+
+  while (n) {
+    if (*s == '\0' || *s == '\n' || *s == 8 || *s == 13 || *s == 14) {
+      write(*s++);
+      n--;
+      continue;
+    }
+    if (_cursor_x >= lim) {
+      _cursor_x = 0;
+      inc_txtline();
+    }
+    cx = _cursor_x + *_font;
+    for (k = 1; k < n && cx < lim; k++, cx += *_font)
+      if (s[k] == '\0' || s[k] == '\n' || s[k] == 8 || s[k] == 13 || s[k] == 14)
+        break;
+    text_run(_cursor_x, _cursor_y, s, k);
+    _cursor_x = cx;
+    s += k;
+    n -= k;
+  }
+}
+
 void TTVout::write(const char *str) {
-  while (*str)
-    write(*str++);
+  write_text((const uint8_t*)str, strlen(str));
 }
 
 void TTVout::write(const uint8_t *buffer, uint8_t size) {
-  while (size--)
-    write(*buffer++);
+  write_text(buffer, size);
+}
+
+// Write the string str (len characters, len < 0: up to '\0') from (x,y)
+void TTVout::draw_text(uint16_t x, uint16_t y, const char* str, int16_t len) {
+  set_cursor(x, y);
+  write_text((const uint8_t*)str, len < 0 ? strlen(str) : len);
 }
 
 void TTVout::write(uint8_t c) {
@@ -516,7 +2547,7 @@ void TTVout::write(uint8_t c) {
     case 14:      //form feed new page(clear screen)
       break;
     default:
-      if (_cursor_x >= (_hres*8 - *_font)) {
+      if (_cursor_x >= (text_width() - *_font)) {
         _cursor_x = 0;
         inc_txtline();
         print_char(_cursor_x,_cursor_y,c);
@@ -551,11 +2582,7 @@ void TTVout::print(long n, int base){
   if (base == 0) {
     write(n);
   } else if (base == 10) {
-    if (n < 0) {
-      print('-');
-      n = -n;
-    }
-    printNumber(n, 10);
+    print_fixed(n < 0 ? 0 - (uint32_t)n : n, 0, 0, n < 0, 0, ' ');
   } else {
     printNumber(n, base);
   }
@@ -608,7 +2635,7 @@ void TTVout::println(double n, int digits) {
 
 void TTVout::printPGM(const char str[]) {
   char c;
-  while (c = *str) {
+  while ((c = *str)) {
     str++;
     write(c);
   }
@@ -617,7 +2644,7 @@ void TTVout::printPGM(const char str[]) {
 void TTVout::printPGM(uint16_t x, uint16_t y, const char str[]) {
   char c;
   _cursor_x = x; _cursor_y = y;
-  while (c = *str) {
+  while ((c = *str)) {
     str++;
     write(c);
   }
@@ -708,58 +2735,156 @@ void TTVout::println(uint16_t x, uint16_t y, double n, int digits){
   print(n, digits);  println();
 }
 
-void TTVout::printNumber(unsigned long n, uint8_t base){
-  unsigned char buf[8 * sizeof(long)]; // Assumes 8-bit chars. 
-  unsigned long i = 0;
+// Digit pairs "00" to "99"
+static const char dec_pairs[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static const uint32_t pow10_tbl[10] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// Decimal digits of n written backward from p, returns the first digit
+// Two digits at a time, n / 100 by the multiplication with its reciprocal.
+static char* fmt_dec(char* p, uint32_t n) {
+  uint32_t q;
+
+  while (n >= 100) {
+    q = ((uint64_t)n * 0x51eb851fUL) >> 37;
+    p -= 2;
+    memcpy(p, &dec_pairs[(n - q*100)*2], 2);
+    n = q;
+  }
+  if (n >= 10) {
+    p -= 2;
+    memcpy(p, &dec_pairs[n*2], 2);
+  } else
+    *--p = '0' + n;
+  return p;
+}
 
-  if (n == 0) {
-    print('0');
-    return;
-  } 
+// Draw the number n.f (f: digits decimals, 0..9) in a field of width characters
+// width > 0: right aligned, width < 0: left aligned (up to 32 characters)
+void TTVout::print_fixed(uint32_t n, uint32_t f, uint8_t digits, bool neg, int8_t width, char pad) {
+  char buf[48];
+  char* e = buf + sizeof(buf);
+  char* p = e;
+  uint8_t len, w = width < 0 ? -width : width;
+
+  if (digits) {
+    p = fmt_dec(p, f);
+    while (e - p < digits)
+      *--p = '0';
+    *--p = '.';
+  }
+  p = fmt_dec(p, n);
+  if (w > 32)
+    w = 32;
+  len = e - p + neg;
+  if (width > 0 && pad == '0')
+    while (len < w) {
+      *--p = '0';
+      len++;
+    }
+  if (neg)
+    *--p = '-';
+  if (width > 0)
+    while (len < w) {
+      *--p = pad;
+      len++;
+    }
+  if (width < 0) {
+    memmove(buf, p, len);
+    p = buf;
+    while (len < w)
+      p[len++] = pad;
+  }
+  write_text((const uint8_t*)p, len);
+}
 
-  while (n > 0) {
-    buf[i++] = n % base;
-    n /= base;
+// Decimal fixed point number n / 10^dp with dp (0..9) decimals
+void TTVout::print_dec(long n, uint8_t dp, int8_t width, char pad) {
+  uint32_t u = n < 0 ? 0 - (uint32_t)n : n, ip;
+
+  if (dp > 9)
+    dp = 9;
+  ip = dp ? u / pow10_tbl[dp] : u;
+  print_fixed(ip, u - ip * pow10_tbl[dp], dp, n < 0, width, pad);
+}
+
+// Binary fixed point number n / 2^qbits (0..31) rounded to digits (0..9) decimals
+void TTVout::print_fix(long n, uint8_t qbits, uint8_t digits, int8_t width, char pad) {
+  uint32_t u = n < 0 ? 0 - (uint32_t)n : n, ip, f;
+
+  if (qbits > 31)
+    qbits = 31;
+  if (digits > 9)
+    digits = 9;
+  ip = u >> qbits;
+  f = qbits ? ((uint64_t)(u & ((1UL << qbits) - 1)) * pow10_tbl[digits] + (1UL << (qbits - 1))) >> qbits : 0;
+  if (f >= pow10_tbl[digits]) {
+    f -= pow10_tbl[digits];
+    ip++;
   }
+  print_fixed(ip, f, digits, n < 0, width, pad);
+}
+
+void TTVout::printNumber(unsigned long n, uint8_t base){
+  char buf[8 * sizeof(long)];
+  char* e = buf + sizeof(buf);
+  char* p = e;
+  uint8_t sh, d;
 
-  for (; i > 0; i--)
-    print((char) (buf[i - 1] < 10 ?
-      '0' + buf[i - 1] :
-      'A' + buf[i - 1] - 10));
+  if (base == 10) {
+    print_fixed(n, 0, 0, false, 0, ' ');
+    return;
+  }
+  if (base < 2)
+    base = 10;
+  sh = base == 2 ? 1 : base == 8 ? 3 : base == 16 ? 4 : 0;
+  do {
+    if (sh) {
+      d = n & (base - 1);
+      n >>= sh;
+    } else {
+      d = n % base;
+      n /= base;
+    }
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+  } while (n);
+  write_text((const uint8_t*)p, e - p);
 }
 
+// Up to 9 decimals, numbers from 4294967040 print "ovf"
 void TTVout::printFloat(double number, uint8_t digits) { 
-  // Handle negative numbers
-  if (number < 0.0)
-  {
-     print('-');
-     number = -number;
-  }
+  uint32_t ip, f = 0;
+  bool neg = number < 0.0;
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
-    rounding /= 10.0;
-  
-  number += rounding;
-
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  print(int_part);
-
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0)
-    print("."); 
-
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
-  {
-    remainder *= 10.0;
-    int toPrint = int(remainder);
-    print(toPrint);
-    remainder -= toPrint; 
-  } 
+  if (number != number) {
+    write("nan");
+    return;
+  }
+  if (neg)
+    number = -number;
+  if (!(number < 4294967040.0)) {
+    write(neg ? "-ovf" : "ovf");
+    return;
+  }
+  if (digits > 9)
+    digits = 9;
+
+  // Integer part and the decimals rounded as an integer
+  ip = (uint32_t)number;
+  number -= ip;
+  f = (uint32_t)(number * pow10_tbl[digits] + 0.5);
+  if (f >= pow10_tbl[digits]) {
+    f -= pow10_tbl[digits];
+    ip++;
+  }
+  print_fixed(ip, f, digits, neg, 0, ' ');
 }
 
 //
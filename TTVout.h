@@ -40,6 +40,27 @@ application as possible.
 // Fixed the selection date of 2017/04/30, SPI 1, SPI 2 update possible
 // updated date 2017/06/25, NTSC object is modified to dynamic generation, NTSC external memory area specification supported
 // Update date 2017/11/18, change the return value of hres (), hres () to int16_t
+// Update date 2026/10/18, gray level of a dot of the 4 gray level modes (set_gray, get_gray) added
+// Update date 2026/10/18, VRAM line stride and half word byte swap (TNTSC SC_DMA16) supported
+// Update date 2026/10/18, raster operation engine (rop_rect) for fill, draw_row, draw_rect and cls
+// Update date 2026/10/18, clip rectangle (setClipRect, resetClipRect) added
+// Update date 2026/10/18, bitblt added
+// Update date 2026/10/18, asynchronous cls, fill and shift by DMA (cls_async, fill_async, shift_async)
+// Update date 2026/10/18, shift_rect added
+// Update date 2026/10/18, cache of pre-shifted glyphs (set_glyph_cache) added
+// Update date 2026/10/18, draw_text added, strings are drawn a font line at a time
+// Update date 2026/10/18, print_dec, print_fix (fixed point numbers in fields) added
+// Update date 2026/10/18, set_text_style (outlined and shadowed text) added
+// Update date 2026/10/18, fill_polygon, fill_triangle added
+// Update date 2026/10/18, draw_ellipse, draw_arc, draw_rrect added
+// Update date 2026/10/18, draw_bezier added
+// Update date 2026/10/18, line width of draw_line, draw_polyline added
+// Update date 2026/10/18, 8x8 pattern brush of fills (set_pattern) added
+// Update date 2026/10/18, flood_fill added
+// Update date 2026/10/18, bitblt_rot, bitmap_rot, set_text_rotation (rotated and mirrored blits and text) added
+// Update date 2026/10/18, bitblt_scaled, bitmap_scaled, scaled print_char added
+// Update date 2026/10/18, drawing to off-screen bitmaps (Surface, set_surface, blit) added
+// Update date 2026/10/18, sprites with save-under (add_sprite, move_sprite, hide_sprite) added
 //
 */
 
@@ -53,6 +74,45 @@ application as possible.
 #define BLACK         0
 #define INVERT        2
 
+// Raster operations of rop_rect() (pat: pattern byte, 0xff = solid)
+#define ROP_CLEAR     0   // dst &= ~pat (same as BLACK)
+#define ROP_SET       1   // dst |= pat  (same as WHITE)
+#define ROP_XOR       2   // dst ^= pat  (same as INVERT)
+#define ROP_COPY      3   // dst = pat
+
+// Raster operations of bitblt()
+#define BLT_COPY      0   // dst = src
+#define BLT_OR        1   // dst |= src
+#define BLT_AND       2   // dst &= src
+#define BLT_XOR       3   // dst ^= src
+#define BLT_ANDNOT    4   // dst &= ~src
+
+// Rotations of bitblt_rot(), bitmap_rot() and set_text_rotation()
+#define ROT_0         0
+#define ROT_90        1   // clockwise
+#define ROT_180       2
+#define ROT_270       3
+#define MIRROR        4   // mirrored left-right before the rotation
+
+// Text styles of set_text_style()
+// The outline and the shadow cover the neighbouring characters, draw strings
+// with print() / draw_text() rather than character by character.
+#define TEXT_NORMAL   0   // glyph cells are copied
+#define TEXT_OUTLINE  1   // one dot black ring around the glyphs
+#define TEXT_SHADOW   2   // black shadow one dot to the lower right
+
+// Patterns of set_pattern() (8 lines of 8 dots, MSB: left)
+extern const uint8_t PAT_GRAY25[8];   // 1 dot of 4
+extern const uint8_t PAT_GRAY50[8];   // checker board
+extern const uint8_t PAT_GRAY75[8];   // 3 dots of 4
+
+#define POLY_MAX_POINTS 32  // vertices of fill_polygon() and draw_polyline()
+#define FLOOD_SEEDS     32  // seed stack of flood_fill() without a buffer
+
+// Joins of draw_polyline()
+#define JOIN_MITER    0   // pointed corners (bevel if sharper than 60 degrees)
+#define JOIN_BEVEL    1   // cut corners
+
 #define UP            0
 #define DOWN          1
 #define LEFT          2
@@ -70,14 +130,41 @@ application as possible.
 #define clear_screen()      fill(0)
 #define invert(color)       fill(2)
 
+// 1bpp bitmap to draw to (set_surface) or to copy from (blit)
+struct Surface {
+  uint8_t* buf;       // line 0 (MSB = left dot)
+  uint16_t width;     // dots
+  uint16_t height;    // lines
+  uint16_t stride;    // bytes per line
+  uint8_t  bswap;     // bytes of each half word swapped (0: no 1: yes)
+};
+
+// Sprite of add_sprite() (memory of the caller)
+// The sprites are drawn in the order of add_sprite(), the last one on top.
+struct Sprite {
+  const uint8_t* image;       // w x h dots, (w + 7)/8 bytes per line
+  const uint8_t* mask;        // dots drawn, same layout (NULL: all)
+  uint8_t* save;              // dots under the sprite, SPRITE_SAVE_SIZE(w, h) bytes
+  int16_t  w, h;
+  int16_t  x, y;              // position
+  Sprite*  next;              // next sprite above
+  int16_t  sx, sy, sw, sh;    // saved rectangle (sw 0: nothing saved)
+  bool     shown;
+  bool     redraw;            // taken off during a move
+};
+#define SPRITE_SAVE_SIZE(w, h)  ((((w) + 14) / 8) * (h))
+
+struct GlyphCache;
+struct ArcSector;
+
 class TTVout {
   private:
-    void init(uint8_t* vram, uint16_t width, uint16_t height) ;
+    void init(uint8_t* vram, uint16_t width, uint16_t height, uint16_t stride, uint8_t bswap) ;
 
   public:
 	  TNTSC_class* TNTSC;
 
-  TTVout() {TNTSC= &::TNTSC;} ;      // constructor
+  TTVout() {TNTSC= &::TNTSC; _gcache = NULL; _sprites = NULL;} ;      // constructor
     ~TTVout() {};                    // destructor 
     void begin(uint8_t mode=SC_DEFAULT,uint8_t spino = 1,uint8_t* extram=NULL); // Start using
     void end() {TNTSC->end();};  // End usage
@@ -85,32 +172,77 @@ class TTVout {
     uint16_t hres() {return _width;} ;  // Acquire number of horizontal dots on screen
     uint16_t vres() {return _height;} ; // Acquire vertical dot number of screen
     uint8_t* VRAM() {  return _screen;};// Obtain VRM start address
+    void set_surface(const Surface* s = NULL); // Draw to the bitmap s (NULL: the screen)
+    Surface surface() { Surface s = { _screen, _width, _height, _hres, _bswap }; return s; }; // Bitmap drawn to
     char char_line();
-    void delay(uint32_t x) {::delay(x);};  // delay (milliseconds)
+    void delay(uint32_t x) {TNTSC->delay(x);};  // delay (milliseconds)
+    void setIdleMode(uint8_t mode) {TNTSC->setIdleMode(mode);} // Idle mode of the wait functions
     void delay_frame(uint16_t x);
     unsigned long millis() {return ::millis();} ;
     void setBktmStartHook(void (*func)()); // Blanking period start hook setting
     void setBktmEndHook(void (*func)());   // Blanking period end hook setting
     unsigned char get_pixel(int16_t x, int16_t y);
     void set_pixel(int16_t x, int16_t y, uint8_t d) ;
-    void draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t dt);
+    void set_gray(int16_t x, int16_t y, uint8_t level);  // Gray level 0..3 of a dot (4 gray level modes)
+    uint8_t get_gray(int16_t x, int16_t y);
+    void draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t dt, uint8_t width = 1);
+    void draw_polyline(const int16_t* pts, uint8_t n, uint8_t c, uint8_t width = 1, uint8_t join = JOIN_MITER);
     void draw_row(int16_t line, int16_t x0, int16_t x1, uint8_t c);
     void draw_column(int16_t row, int16_t y0, int16_t y1, uint8_t c);
     void fill(uint8_t color);
+    void rop_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t op, uint8_t pat = 0xff);
+    void setClipRect(int16_t x, int16_t y, int16_t w, int16_t h); // Limit drawing to a rectangle
+    void resetClipRect() { setClipRect(0, 0, _width, _height); }; // Drawing on the whole screen
+    void set_pattern(const uint8_t* pat, int16_t ox = 0, int16_t oy = 0); // 8x8 brush of fills (NULL: solid), ox,oy: origin
     void shift(uint8_t distance, uint8_t direction);
+    void shift_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t distance, uint8_t direction); // Scroll a part of the screen
+    bool cls_async(void (*done)() = NULL, uint8_t flags = 0) { return TNTSC->fillAsync(0, _vram.height, 0, done, flags); }
+    bool fill_async(uint8_t color, void (*done)() = NULL, uint8_t flags = 0);
+    bool shift_async(uint8_t distance, uint8_t direction, void (*done)() = NULL, uint8_t flags = 0);
+    bool async_busy() { return TNTSC->asyncBusy(); }  // DMA operations not finished
+    void async_wait() { TNTSC->asyncWait(); }         // Wait for the DMA operations
     void draw_rect(int16_t x0, int16_t y0, int16_t w, int16_t h, uint8_t c, int8_t fc = -1); 
     void draw_circle(int16_t x0, int16_t y0, int16_t radius, uint8_t c, int8_t fc = -1);
+    void draw_ellipse(int16_t x0, int16_t y0, int16_t rx, int16_t ry, uint8_t c, int8_t fc = -1);
+    void draw_arc(int16_t x0, int16_t y0, int16_t rx, int16_t ry, int16_t start, int16_t end, uint8_t c, int8_t fc = -1); // degrees, 0: right, clockwise
+    void draw_rrect(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t r, uint8_t c, int8_t fc = -1); // rounded corners of radius r
+    void draw_bezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t c); // quadratic
+    void draw_bezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+                     int16_t x3, int16_t y3, uint8_t c);                                               // cubic
+    void fill_polygon(const int16_t* pts, uint8_t n, uint8_t c); // pts: x0,y0, x1,y1, ... (n vertices)
+    void fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t c);
+    bool flood_fill(int16_t x, int16_t y, uint8_t c, void* buf = NULL, uint16_t size = 0); // buf: seed stack (false: seeds lost)
     void bitmap(uint16_t x, uint16_t y, const unsigned char * bmp, uint16_t i = 0, uint16_t width = 0, uint16_t lines = 0);
+    void bitblt(int16_t x, int16_t y, const uint8_t* src, uint16_t stride, int16_t sx, int16_t sy,
+                int16_t w, int16_t h, uint8_t op = BLT_COPY, const uint8_t* mask = NULL); // Copy a part of a 1bpp image
+    void blit(int16_t x, int16_t y, const Surface& src, int16_t sx = 0, int16_t sy = 0,
+              int16_t w = -1, int16_t h = -1, uint8_t op = BLT_COPY);         // Copy a part of a bitmap (w, h < 0: to its ends)
+    void bitblt_rot(int16_t x, int16_t y, const uint8_t* src, uint16_t stride, int16_t w, int16_t h,
+                    uint8_t rot, uint8_t op = BLT_COPY);                     // Copy a rotated / mirrored 1bpp image
+    void bitmap_rot(int16_t x, int16_t y, const unsigned char* bmp, uint8_t rot, uint8_t op = BLT_COPY);
+    void bitblt_scaled(int16_t x, int16_t y, const uint8_t* src, uint16_t stride, int16_t w, int16_t h,
+                       uint8_t xs, uint8_t ys, uint8_t op = BLT_COPY);         // Copy a 1bpp image xs x ys times larger
+    void bitmap_scaled(int16_t x, int16_t y, const unsigned char* bmp, uint8_t xs, uint8_t ys, uint8_t op = BLT_COPY);
 	void bitmap8(uint8_t x, uint8_t y, const unsigned char * bmp, uint16_t i = 0, uint8_t width = 0, uint8_t lines = 0) 
 		 { bitmap((uint8_t)x,(uint8_t)y,bmp,i,width,lines); };
+    void add_sprite(Sprite* s, const uint8_t* image, const uint8_t* mask, int16_t w, int16_t h, uint8_t* save); // on top, hidden
+    void remove_sprite(Sprite* s);
+    void move_sprite(Sprite* s, int16_t x, int16_t y) { sprite_update(s, true, x, y); }; // Show s at (x,y)
+    void hide_sprite(Sprite* s) { sprite_update(s, false, s->x, s->y); };
     void tone(uint16_t frequency, uint16_t duration_ms=0);
     void noTone();
     void print_char(uint16_t x, uint16_t y, uint8_t c); // 
+    void print_char(uint16_t x, uint16_t y, uint8_t c, uint8_t xs, uint8_t ys); // xs x ys times larger (1..16)
     void set_cursor(uint16_t, uint16_t);
     void select_font(const unsigned char * f);
+    void set_text_style(uint8_t style) { _text_style = style; }; // TEXT_NORMAL, TEXT_OUTLINE, TEXT_SHADOW
+    void set_text_rotation(uint8_t rot); // ROT_0 .. ROT_270, MIRROR (the cursor is on the rotated screen)
+    bool set_glyph_cache(void* buf, uint16_t size, const char* chars = NULL, uint8_t rows = 8); // Pre-shifted glyphs in buf
+    void flush_glyph_cache();  // Forget the cached glyphs (font data changed)
     void write(uint8_t);
     void write(const char *str);
     void write(const uint8_t *buffer, uint8_t size);
+    void draw_text(uint16_t x, uint16_t y, const char* str, int16_t len = -1); // write() from (x,y), len < 0: up to '\0'
     void print(const char[]);
     void print(char, int = BYTE);
     void print(unsigned char, int = BYTE);
@@ -139,6 +271,9 @@ class TTVout {
     void println(uint16_t, uint16_t, double, int = 2);
     void println(uint16_t, uint16_t);
 
+    void print_dec(long n, uint8_t dp = 0, int8_t width = 0, char pad = ' ');  // n / 10^dp, width < 0: left aligned
+    void print_fix(long n, uint8_t qbits, uint8_t digits, int8_t width = 0, char pad = ' '); // n / 2^qbits
+
     void println(const char[]);
     void println(char, int = BYTE);
     void println(unsigned char, int = BYTE);
@@ -159,22 +294,49 @@ class TTVout {
     void printFloat(double, uint8_t);
 
   private:   
+    void rop_span(uint8_t* row, int16_t x0, int16_t x1, uint8_t op, uint8_t pat);
+    void rop_screen(uint8_t op);
+    uint8_t outcode(int16_t x, int16_t y);
+    bool clip_line(int16_t& x0, int16_t& y0, int16_t& x1, int16_t& y1, int& err);
+    bool clip_box(int16_t& x, int16_t& y, int16_t& w, int16_t& h);
+    void round_shape(int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1, int16_t rx, int16_t ry,
+                     uint8_t c, bool fill, const ArcSector* as);
+    void stroke(const int16_t* pts, uint8_t n, uint8_t c, uint8_t width, uint8_t join);
+    void draw_curve(const int32_t* px, const int32_t* py, uint32_t len, uint8_t c);
+    void arc_span(int16_t y, int16_t a, int16_t b, uint8_t c, bool fill, const ArcSector* as);
+    void fill_row(int16_t line, int16_t x0, int16_t x1, uint8_t c, bool pat = true);
+    void move_span(uint8_t* dst, uint8_t* src, int16_t x0, int16_t x1, int16_t d);
+    bool cached_char(uint16_t x, uint16_t y, uint8_t c);
+    void sprite_update(Sprite* s, bool show, int16_t x, int16_t y);
+    void sprite_save(Sprite* s);
+    void sprite_restore(Sprite* s);
+    void sprite_unwind(Sprite* s);
+    void write_text(const uint8_t* s, uint16_t n);
+    void text_run(uint16_t x, uint16_t y, const uint8_t* s, uint16_t n);
+    void text_lines(uint16_t x, uint16_t y, const uint8_t* s, uint16_t n);
+    void print_fixed(uint32_t n, uint32_t f, uint8_t digits, bool neg, int8_t width, char pad);
+    uint16_t text_width()  { return (_text_rot & 1) ? _height : _width; };  // screen of the text
+    uint16_t text_height() { return (_text_rot & 1) ? _width : _height; };
+    void blt_row(uint8_t* row, int16_t x, const uint8_t* src, const uint8_t* mask, uint16_t s, int16_t n, uint8_t op);
     void sp(uint16_t x, uint16_t y, uint8_t c) {
     #if BITBAND==1
+      if (_adr) {
+        uint32_t bit = (_hres*y + ((x/8)^_bswap))*8 +7 -(x&7);
+        if (c==1)
+          _adr[bit] = 1;
+        else if (c==0)
+          _adr[bit] = 0;
+        else 
+          _adr[bit] ^= 1;
+        return;
+      }
+    #endif
       if (c==1)
-        _adr[_width*y+ (x&0xf8) +7 -(x&7)] = 1;
-      else if (c==0)
-        _adr[_width*y+ (x&0xf8) +7 -(x&7)] = 0;
-      else 
-        _adr[_width*y+ (x&0xf8) +7 -(x&7)] ^= 1;
-    #else
-      if (c==1)
-        _screen[(x/8) + (y*_hres)] |= 0x80 >> (x&7);
+        _screen[((x/8)^_bswap) + (y*_hres)] |= 0x80 >> (x&7);
       else if (c==0)
-        _screen[(x/8) + (y*_hres)] &= ~0x80 >> (x&7);
+        _screen[((x/8)^_bswap) + (y*_hres)] &= ~(0x80 >> (x&7));
       else
-        _screen[(x/8) + (y*_hres)] ^= 0x80 >> (x&7);
-    #endif
+        _screen[((x/8)^_bswap) + (y*_hres)] ^= 0x80 >> (x&7);
     }
   
   private:    
@@ -185,9 +347,21 @@ class TTVout {
     uint8_t* _screen;        // frame buffer address
     uint16_t _width;         // Number of horizontal dots on screen
     uint16_t _height;        // screen vertical dot number
-    uint16_t _hres;          // number of horizontal bytes
+    uint16_t _hres;          // number of horizontal bytes (VRAM line stride)
+    uint8_t  _bswap;         // bytes of each half word swapped (0: no 1: yes)
+    uint8_t  _text_style;    // TEXT_NORMAL, TEXT_OUTLINE, TEXT_SHADOW
+    uint8_t  _text_rot;      // rotation of the text (ROT_0 .. ROT_270, MIRROR)
+    bool     _pattern_on;    // fills use _pattern
+    uint8_t  _pattern[8];    // brush of the lines y & 7, rotated to the origin
     uint16_t _vres;          // Number of vertical dots
-    volatile uint32_t*_adr;  // frame buffer bit band address
+    int16_t  _clip_x0;       // clip rectangle (inclusive)
+    int16_t  _clip_y0;
+    int16_t  _clip_x1;
+    int16_t  _clip_y1;
+    volatile uint32_t*_adr;  // frame buffer bit band address (NULL: not in the bit band region)
+    Surface  _vram;          // the screen (VRAM of TNTSC)
+    GlyphCache* _gcache;     // cache of pre-shifted glyphs (NULL: not used)
+    Sprite*  _sprites;       // lowest sprite
 };
 
 #endif
@@ -0,0 +1,220 @@
+// Drawing benchmarks, run by setup() when BENCH is 1 (see stm32_osd.ino)
+// The times are taken by the DWT cycle counter (started by TNTSC_class::begin())
+// while the video is displayed, so they include the video interrupts.
+// The results are printed to Serial.
+#if BENCH
+
+#define DWT_CYCCNT   (*(volatile uint32_t *)0xE0001004)
+#define BENCH_SPANS  64
+
+static uint32_t bench_t;
+
+static void bench_start() {
+  bench_t = DWT_CYCCNT;
+}
+
+// Print the time of one of the n calls since bench_start()
+static uint32_t bench_end(const char* name, uint16_t n) {
+  uint32_t c = (DWT_CYCCNT - bench_t) / n;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(c);
+  Serial.print(" cycles, ");
+  Serial.print(c / (F_CPU / 1000000L));
+  Serial.println(" us");
+  return c;
+}
+
+// Byte loops of fill(INVERT) and draw_row() before the raster operation engine
+static void old_fill_invert(uint8_t* s, uint16_t hres, uint16_t vres) {
+  for (int16_t i = 0; i < vres; i++)
+    for (int16_t j = 0; j < hres; j++)
+      s[i*hres+j] = ~s[i*hres+j];
+}
+
+static void old_draw_row(uint8_t* s, uint16_t hres, int16_t line, int16_t x0, int16_t x1, uint8_t c) {
+  uint8_t lbit, rbit;
+  lbit = 0xff >> (x0&7);
+  x0 = x0/8 + hres*line;
+  rbit = ~(0xff >> (x1&7));
+  x1 = x1/8 + hres*line;
+  if (x0 == x1) {
+    lbit = lbit & rbit;
+    rbit = 0;
+  }
+  if (c == WHITE) {
+    s[x0++] |= lbit;
+    while (x0 < x1)
+      s[x0++] = 0xff;
+    s[x0] |= rbit;
+  }
+  else if (c == BLACK) {
+    s[x0++] &= ~lbit;
+    while (x0 < x1)
+      s[x0++] = 0;
+    s[x0] &= ~rbit;
+  }
+  else if (c == INVERT) {
+    s[x0++] ^= lbit;
+    while (x0 < x1)
+      s[x0++] ^= 0xff;
+    s[x0] ^= rbit;
+  }
+}
+
+// fill(), draw_row() and filled draw_rect() against the byte loops
+static void bench_rop() {
+  uint8_t* s = TV.VRAM();
+  uint16_t hres = TNTSC.stride();
+  int16_t w = TV.hres(), h = TV.vres();
+  int16_t y[BENCH_SPANS], x0[BENCH_SPANS], x1[BENCH_SPANS];
+  uint8_t i, k;
+
+  for (i = 0; i < BENCH_SPANS; i++) {
+    y[i] = random(h);
+    x0[i] = random(w - 1);
+    x1[i] = random(x0[i] + 1, w);
+  }
+  bench_start();
+  for (k = 0; k < 10; k++)
+    old_fill_invert(s, hres, h);
+  bench_end("old fill(INVERT)", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.fill(INVERT);
+  bench_end("fill(INVERT)", 10);
+
+  bench_start();
+  for (k = 0; k < 10; k++)
+    for (i = 0; i < BENCH_SPANS; i++)
+      old_draw_row(s, hres, y[i], x0[i], x1[i], INVERT);
+  bench_end("old draw_row x64", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    for (i = 0; i < BENCH_SPANS; i++)
+      TV.draw_row(y[i], x0[i], x1[i], INVERT);
+  bench_end("draw_row x64", 10);
+
+  bench_start();
+  for (k = 0; k < 10; k++)
+    for (int16_t j = 4; j < h - 4; j++)
+      old_draw_row(s, hres, j, 3, w - 5, INVERT);
+  bench_end("old draw_rect full", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.draw_rect(3, 4, w - 8, h - 8, INVERT, INVERT);
+  bench_end("draw_rect full", 10);
+  TV.clear_screen();
+}
+
+// shift() UP and LEFT before the word moves
+static void old_shift(uint8_t* s, uint16_t hres, uint16_t vres, uint8_t distance, uint8_t direction) {
+  uint8_t * src;
+  uint8_t * dst;
+  uint8_t * end;
+  uint8_t shift = distance & 7;
+  uint8_t tmp;
+  if (direction == UP) {
+    dst = s;
+    src = s + distance*hres;
+    end = s + vres*hres;
+    while (src < end) {
+      *dst = *src;
+      *src = 0;
+      dst++;
+      src++;
+    }
+    return;
+  }
+  for (uint8_t line = 0; line < vres; line++) {
+    dst = s + hres*line;
+    src = dst + distance/8;
+    end = dst + hres-2;
+    while (src <= end) {
+      tmp = *src << shift;
+      *src = 0;
+      src++;
+      tmp |= *src >> (8 - shift);
+      *dst = tmp;
+      dst++;
+    }
+    tmp = *src << shift;
+    *src = 0;
+    *dst = tmp;
+  }
+}
+
+// shift() of the whole screen against the byte loops and shift_rect() of a pane
+static void bench_shift() {
+  uint8_t* s = TV.VRAM();
+  uint16_t hres = TNTSC.stride();
+  int16_t w = TV.hres(), h = TV.vres();
+  uint8_t k;
+
+  bench_start();
+  for (k = 0; k < 10; k++)
+    old_shift(s, hres, h, 1, LEFT);
+  bench_end("old shift LEFT 1", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.shift(1, LEFT);
+  bench_end("shift LEFT 1", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    old_shift(s, hres, h, 1, UP);
+  bench_end("old shift UP 1", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.shift(1, UP);
+  bench_end("shift UP 1", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.shift_rect(0, h / 4, w, h / 2, 1, LEFT);
+  bench_end("shift_rect half LEFT 1", 10);
+  bench_start();
+  for (k = 0; k < 10; k++)
+    TV.shift_rect(4, h / 4, w - 8, h / 2, 1, UP);
+  bench_end("shift_rect half UP 1", 10);
+  TV.clear_screen();
+}
+
+// Drawing mix of the 8 / 16 bit SPI DMA comparison
+static void bench_mix() {
+  TV.fill(INVERT);
+  TV.draw_rect(20, 20, 200, 100, INVERT, INVERT);
+  for (uint8_t i = 0; i < 16; i++)
+    TV.draw_line(0, i * 13, TV.hres() - 1, TV.vres() - 1 - i * 13, INVERT);
+  TV.draw_circle(TV.hres() / 2, TV.vres() / 2, 60, INVERT, INVERT);
+  TV.print(0, 0, "The quick brown fox jumps over the lazy dog");
+}
+
+// Drawing while the video is displayed by 8 bit and by 16 bit (SC_DMA16) SPI DMA
+// The drawing takes the SRAM bus cycles left by the line DMA.
+static void bench_dma16() {
+  static const char* name[] = { "mix, 8 bit DMA", "mix, 16 bit DMA" };
+  uint8_t mode = TNTSC.screen();
+
+  for (uint8_t d = 0; d < 2; d++) {
+    TV.end();
+    TV.begin(d ? mode | SC_DMA16 : mode);
+    TV.delay_frame(1);
+    bench_start();
+    for (uint8_t k = 0; k < 50; k++)
+      bench_mix();
+    bench_end(name[d], 50);
+  }
+  TV.end();
+  TV.begin(mode);
+}
+
+void bench() {
+  Serial.print("bench ");
+  Serial.print(TV.hres());
+  Serial.print("x");
+  Serial.println(TV.vres());
+  bench_rop();
+  bench_shift();
+  bench_dma16();
+}
+
+#endif
@@ -423,8 +423,7 @@ PROGMEM const unsigned char font4x6[] = {
 0b11000000,
 0b00000000,
 0,				//for the life of me I have no idea why this is needed....
-//\
-0b10000000,
+//\ 0b10000000,
 0b10000000,
 0b01000000,
 0b00100000,
@@ -3,6 +3,8 @@
 #include "schematic.h"
 #include "TVOlogo.h"
 
+#define BENCH 0  // 1: run the drawing benchmarks of bench.ino first (results on Serial)
+
 TTVout TV;
 
 int zOff = 150;
@@ -30,6 +32,9 @@ void setup() {
   delay(1000);
   TV.begin(SC_448x216);
   TV.select_font(font8x8);
+#if BENCH
+  bench();
+#endif
 
   intro();
   TV.println("I am the TVout\nlibrary running on a freeduino\n");
@@ -135,17 +140,14 @@ void loop() {
 
 void intro() {
 unsigned char w,l,wb;
-  int index;
   w = pgm_read_byte(TVOlogo);
   l = pgm_read_byte(TVOlogo+1);
   if (w&7)
     wb = w/8 + 1;
   else
     wb = w/8;
-  index = wb*(l-1) + 2;
   for ( unsigned char i = 1; i < l; i++ ) {
-    TV.bitmap((TV.hres() - w)/2,0,TVOlogo,index,w,i);
-    index-= wb;
+    TV.bitblt((TV.hres() - w)/2,0,TVOlogo+2,wb,0,l-i,w,i);  // bottom i lines of the logo
     TV.delay(50);
   }
   for (unsigned char i = 0; i < (TV.vres() - l)/2; i++) {
@@ -0,0 +1,42 @@
+// Arduino.h for host builds of TTVout (see test_draw.cpp)
+// Only what TNTSC.h, TTVout.h/.cpp and the fonts use on the host.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef F_CPU
+#define F_CPU 72000000L
+#endif
+
+#define PROGMEM
+#define __FLASH__
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+typedef uint8_t byte;
+
+class Print;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// Timer 4 of tone()
+class HardwareTimer {
+  public:
+    void pause() {}
+    void resume() {}
+    void refresh() {}
+    void setPrescaleFactor(uint32_t) {}
+    uint16_t setOverflow(uint32_t v) { return v; }
+    void setCount(uint16_t) {}
+};
+extern HardwareTimer Timer4;
+
+#endif
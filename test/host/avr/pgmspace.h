@@ -0,0 +1,2 @@
+// avr/pgmspace.h for host builds (the fonts are plain arrays)
+#include <Arduino.h>
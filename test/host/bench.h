@@ -0,0 +1,32 @@
+// Timing of the host benchmarks
+// The host times only compare the algorithms, the cycles on the STM32 are
+// measured by bench.ino of the sketch. Build with -fno-tree-vectorize, the
+// Cortex-M3 has no SIMD unit to run vectorized byte loops.
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+#include <stdio.h>
+#include <Arduino.h>
+
+#define BENCH_RUNS  5   // the best of the runs is taken
+
+// Time of one call of f in us (best of BENCH_RUNS runs of reps calls)
+template <typename F> double bench_us(uint32_t reps, F f) {
+  double best = 1e30;
+  for (uint8_t r = 0; r < BENCH_RUNS; r++) {
+    uint32_t t = micros();
+    for (uint32_t i = 0; i < reps; i++)
+      f();
+    t = micros() - t;
+    if (t < best * reps)
+      best = (double)t / reps;
+  }
+  return best;
+}
+
+// One line of results: old and new times and the speed up
+static inline void bench_print(const char* name, double old_us, double new_us) {
+  printf("%-28s old %10.3f us  new %10.3f us  x%.2f\n", name, old_us, new_us, old_us / new_us);
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Host benchmark of draw_bezier() (cubic and quadratic) against drawing
+// the control polygon by draw_line(), 4000 random curves partly outside
+// the 448 x 216 screen (clipped), all INVERT.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_curves.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp -o bench_curves && ./bench_curves
+#include "TTVout.h"
+#include "bench.h"
+
+#define CURVES  4000
+
+static uint8_t vram[56*216];
+static TTVout tv;
+static int16_t p[CURVES][8];
+
+static uint32_t seed = 3;
+static int16_t rnd(int16_t n) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 8) % n;
+}
+
+int main() {
+  double t0, t1, t2;
+  int bad = 0;
+
+  tv.begin(SC_448x216, 1, vram);
+  for (int i = 0; i < CURVES; i++)
+    for (int j = 0; j < 8; j++)
+      p[i][j] = j & 1 ? rnd(300) - 40 : rnd(560) - 60;
+
+  printf("%d curves, 1 call\n", CURVES);
+  t0 = bench_us(20, [] {
+    for (int i = 0; i < CURVES; i++) {
+      tv.draw_line(p[i][0], p[i][1], p[i][2], p[i][3], INVERT);
+      tv.draw_line(p[i][2], p[i][3], p[i][4], p[i][5], INVERT);
+      tv.draw_line(p[i][4], p[i][5], p[i][6], p[i][7], INVERT);
+    }
+  });
+  t1 = bench_us(20, [] {
+    for (int i = 0; i < CURVES; i++)
+      tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], p[i][6], p[i][7], INVERT);
+  });
+  t2 = bench_us(20, [] {
+    for (int i = 0; i < CURVES; i++)
+      tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], INVERT);
+  });
+  bench_print("polygon -> cubic", t0, t1);
+  bench_print("polygon -> quadratic", t0, t2);
+
+  // A curve drawn twice by INVERT must leave nothing (no dot drawn twice)
+  tv.fill(BLACK);
+  for (int i = 0; i < CURVES; i++) {
+    tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], p[i][6], p[i][7], INVERT);
+    tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], p[i][6], p[i][7], INVERT);
+    tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], INVERT);
+    tv.draw_bezier(p[i][0], p[i][1], p[i][2], p[i][3], p[i][4], p[i][5], INVERT);
+  }
+  for (unsigned i = 0; i < sizeof(vram); i++)
+    if (vram[i]) {
+      printf("FAILED: dots left by INVERT twice\n");
+      bad++;
+      break;
+    }
+  return bad;
+}
@@ -0,0 +1,104 @@
+// Host benchmark of print(long) and print(double, 2) against the number
+// formatting they replaced (a division per digit, double arithmetic per
+// decimal, each character written by write()), 30 numbers on 448 x 216.
+// The host has a floating point unit, the soft float of the Cortex-M3 is
+// not modelled.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_print.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp font6x8.cpp -o bench_print && ./bench_print
+#include "TTVout.h"
+#include "fontALL.h"
+#include "bench.h"
+
+static uint8_t vram[56*216];
+static TTVout tv;
+
+// printNumber(), print(long) and printFloat() before the number formatting rewrite
+static void old_print_number(unsigned long n, uint8_t base) {
+  unsigned char buf[8 * sizeof(long)];
+  unsigned long i = 0;
+
+  if (n == 0) {
+    tv.write('0');
+    return;
+  }
+  while (n > 0) {
+    buf[i++] = n % base;
+    n /= base;
+  }
+  for (; i > 0; i--)
+    tv.write((char) (buf[i - 1] < 10 ? '0' + buf[i - 1] : 'A' + buf[i - 1] - 10));
+}
+
+static void old_print_long(long n) {
+  if (n < 0) {
+    tv.write('-');
+    n = -n;
+  }
+  old_print_number(n, 10);
+}
+
+static void old_print_float(double number, uint8_t digits) {
+  if (number < 0.0) {
+     tv.write('-');
+     number = -number;
+  }
+  double rounding = 0.5;
+  for (uint8_t i=0; i<digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  old_print_number(int_part, 10);
+  if (digits > 0)
+    tv.write('.');
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    int toPrint = int(remainder);
+    old_print_long(toPrint);
+    remainder -= toPrint;
+  }
+}
+
+int main() {
+  double t0, t1;
+
+  tv.begin(SC_448x216, 1, vram);
+  tv.select_font(font6x8);
+  printf("30 numbers of 6x8 dots, 1 call\n");
+  t0 = bench_us(2000, [] {
+    for (int i = 0; i < 30; i++) { tv.set_cursor((i%5)*80, (i/5)*10); old_print_long(i*7919L - 104729L*(i&1)); }
+  });
+  t1 = bench_us(2000, [] {
+    for (int i = 0; i < 30; i++) { tv.set_cursor((i%5)*80, (i/5)*10); tv.print(i*7919L - 104729L*(i&1)); }
+  });
+  bench_print("print(long) x30", t0, t1);
+  t0 = bench_us(2000, [] {
+    for (int i = 0; i < 30; i++) { tv.set_cursor((i%5)*80, (i/5)*10); old_print_float((i*7919 - 104729*(i&1))/1000.0, 2); }
+  });
+  t1 = bench_us(2000, [] {
+    for (int i = 0; i < 30; i++) { tv.set_cursor((i%5)*80, (i/5)*10); tv.print((i*7919 - 104729*(i&1))/1000.0, 2); }
+  });
+  bench_print("print(double, 2) x30", t0, t1);
+
+  // Both must print the same text
+  static uint8_t old_vram[sizeof(vram)];
+  for (int k = 0; k < 2; k++) {
+    tv.fill(BLACK);
+    for (int i = 0; i < 30; i++) {
+      long n = i*7919L - 104729L*(i&1);
+      tv.set_cursor((i%5)*80, (i/5)*20);
+      k ? tv.print(n) : old_print_long(n);
+      tv.set_cursor((i%5)*80, (i/5)*20 + 10);
+      k ? tv.print(n/1000.0, 2) : old_print_float(n/1000.0, 2);
+    }
+    if (!k)
+      memcpy(old_vram, vram, sizeof(vram));
+  }
+  if (memcmp(old_vram, vram, sizeof(vram))) {
+    printf("FAILED: the texts differ\n");
+    return 1;
+  }
+  return 0;
+}
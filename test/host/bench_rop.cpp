@@ -0,0 +1,123 @@
+// Host benchmark of the raster operations (fill, draw_row, filled draw_rect)
+// against the byte loops they replaced, on a 448 x 216 screen.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_rop.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp -o bench_rop && ./bench_rop
+#include "TTVout.h"
+#include "bench.h"
+
+#define W     448
+#define H     216
+#define HRES  (W/8)
+#define SPANS 256
+
+static uint8_t vold[HRES*H], vnew[HRES*H];
+static int16_t span[SPANS][3];   // line, x0, x1
+
+// Byte loops of fill() and draw_row() before the raster operation engine
+__attribute__((noinline)) static void old_fill(uint8_t* s, uint8_t color) {
+  switch(color) {
+    case BLACK:
+      for (int16_t i=0; i < H; i++)
+        memset( &s[i*HRES], 0, HRES);
+      break;
+    case WHITE:
+      for (int16_t i=0; i < H; i++)
+        memset( &s[i*HRES], 0xff, HRES);
+      break;
+    case INVERT:
+      for (int16_t i = 0; i < H; i++)
+        for (int16_t j = 0; j < HRES; j++)
+          s[i*HRES+j] = ~s[i*HRES+j];
+      break;
+  }
+}
+
+__attribute__((noinline)) static void old_draw_row(uint8_t* s, int16_t line, int16_t x0, int16_t x1, uint8_t c) {
+  uint8_t lbit, rbit;
+  lbit = 0xff >> (x0&7);
+  x0 = x0/8 + HRES*line;
+  rbit = ~(0xff >> (x1&7));
+  x1 = x1/8 + HRES*line;
+  if (x0 == x1) {
+    lbit = lbit & rbit;
+    rbit = 0;
+  }
+  if (c == WHITE) {
+    s[x0++] |= lbit;
+    while (x0 < x1)
+      s[x0++] = 0xff;
+    s[x0] |= rbit;
+  }
+  else if (c == BLACK) {
+    s[x0++] &= ~lbit;
+    while (x0 < x1)
+      s[x0++] = 0;
+    s[x0] &= ~rbit;
+  }
+  else if (c == INVERT) {
+    s[x0++] ^= lbit;
+    while (x0 < x1)
+      s[x0++] ^= 0xff;
+    s[x0] ^= rbit;
+  }
+}
+
+__attribute__((noinline)) static void old_draw_rect(uint8_t* s, int16_t x0, int16_t y0, int16_t w, int16_t h, uint8_t c) {
+  for (int16_t i = y0; i < y0+h; i++)
+    old_draw_row(s, i, x0, x0+w, c);
+}
+
+int main() {
+  TTVout tv;
+  double t0, t1;
+  uint8_t c;
+
+  tv.begin(SC_448x216, 1, vnew);
+  srand(1);
+  for (int i = 0; i < SPANS; i++) {
+    span[i][0] = rand() % H;
+    span[i][1] = rand() % (W - 1);
+    span[i][2] = span[i][1] + 1 + rand() % (W - 1 - span[i][1]);
+  }
+
+  printf("448 x 216, 1 call (spans: %d calls)\n", SPANS);
+  t0 = bench_us(2000, [] { old_fill(vold, WHITE); });
+  t1 = bench_us(2000, [&] { tv.fill(WHITE); });
+  bench_print("fill(WHITE)", t0, t1);
+  t0 = bench_us(2000, [] { old_fill(vold, INVERT); });
+  t1 = bench_us(2000, [&] { tv.fill(INVERT); });
+  bench_print("fill(INVERT)", t0, t1);
+
+  for (c = BLACK; c <= INVERT; c++) {
+    static const char* name[] = { "draw_row BLACK", "draw_row WHITE", "draw_row INVERT" };
+    t0 = bench_us(2000, [&] { for (int i = 0; i < SPANS; i++) old_draw_row(vold, span[i][0], span[i][1], span[i][2], c); });
+    t1 = bench_us(2000, [&] { for (int i = 0; i < SPANS; i++) tv.draw_row(span[i][0], span[i][1], span[i][2], c); });
+    bench_print(name[c], t0, t1);
+  }
+
+  t0 = bench_us(2000, [] { old_draw_rect(vold, 3, 5, 440, 200, INVERT); });
+  t1 = bench_us(2000, [&] { tv.draw_rect(3, 5, 440, 200, INVERT, INVERT); });
+  bench_print("draw_rect 440x200 INVERT", t0, t1);
+  t0 = bench_us(20000, [] { old_draw_rect(vold, 5, 5, 20, 20, WHITE); });
+  t1 = bench_us(20000, [&] { tv.draw_rect(5, 5, 20, 20, WHITE, WHITE); });
+  bench_print("draw_rect 20x20 WHITE", t0, t1);
+
+  // Both must have drawn the same dots
+  old_fill(vold, BLACK);
+  tv.fill(BLACK);
+  for (int i = 0; i < SPANS; i++) {
+    old_draw_row(vold, span[i][0], span[i][1], span[i][2], i % 3);
+    tv.draw_row(span[i][0], span[i][1], span[i][2], i % 3);
+  }
+  old_draw_rect(vold, 3, 5, 440, 200, INVERT);
+  tv.draw_rect(3, 5, 440, 200, INVERT, INVERT);
+  old_fill(vold, INVERT);
+  tv.fill(INVERT);
+  if (memcmp(vold, vnew, sizeof(vold))) {
+    printf("FAILED: the dots differ\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Host benchmark of bitblt_rot() against rotating the image by set_pixel(),
+// a 64 x 64 image on 448 x 216 in each rotation and mirrored.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_rot.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp -o bench_rot && ./bench_rot
+#include "TTVout.h"
+#include "bench.h"
+
+#define W   64
+#define H   64
+
+static uint8_t vram[56*216];
+static TTVout tv;
+static uint8_t src[W/8*H];
+
+// Rotated / mirrored image by one set_pixel() a dot
+static void pixel_rot(int16_t x, int16_t y, uint8_t rot) {
+  for (int16_t sy = 0; sy < H; sy++)
+    for (int16_t sx = 0; sx < W; sx++) {
+      int16_t mx = rot & MIRROR ? W-1 - sx : sx;
+      uint8_t d = src[sy*(W/8) + sx/8] >> (7 - sx%8) & 1;
+      switch (rot & 3) {
+        case ROT_0:   tv.set_pixel(x + mx, y + sy, d); break;
+        case ROT_90:  tv.set_pixel(x + H-1 - sy, y + mx, d); break;
+        case ROT_180: tv.set_pixel(x + W-1 - mx, y + H-1 - sy, d); break;
+        case ROT_270: tv.set_pixel(x + sy, y + W-1 - mx, d); break;
+      }
+    }
+}
+
+int main() {
+  static const char* rot_name[] = { "ROT_0", "ROT_90", "ROT_180", "ROT_270" };
+  static uint8_t pixel_vram[sizeof(vram)];
+  char name[32];
+  double t0, t1;
+  int bad = 0;
+
+  tv.begin(SC_448x216, 1, vram);
+  for (int i = 0; i < (int)sizeof(src); i++)
+    src[i] = i * 37;
+  printf("%d x %d dots, 1 call\n", W, H);
+  for (uint8_t rot = 0; rot < 8; rot++) {
+    int k = 0;
+    t0 = bench_us(2000, [&] { pixel_rot(k & 63, k & 31, rot); k++; });
+    k = 0;
+    t1 = bench_us(2000, [&] { tv.bitblt_rot(k & 63, k & 31, src, W/8, W, H, rot); k++; });
+    sprintf(name, "%s%s", rot_name[rot & 3], rot & MIRROR ? " | MIRROR" : "");
+    bench_print(name, t0, t1);
+
+    // Both must draw the same dots, at an unaligned position
+    tv.fill(BLACK);
+    pixel_rot(13, 7, rot);
+    memcpy(pixel_vram, vram, sizeof(vram));
+    tv.fill(BLACK);
+    tv.bitblt_rot(13, 7, src, W/8, W, H, rot);
+    if (memcmp(pixel_vram, vram, sizeof(vram))) {
+      printf("FAILED: %s, the dots differ\n", name);
+      bad++;
+    }
+  }
+  return bad;
+}
@@ -0,0 +1,125 @@
+// Host benchmark of shift() on a 448 x 216 screen against the byte loops
+// it replaced, and of shift_rect() on a 448 dot wide pane.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_shift.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp -o bench_shift && ./bench_shift
+#include "TTVout.h"
+#include "bench.h"
+
+#define W     448
+#define H     216
+#define HRES  (W/8)
+
+static uint8_t vold[HRES*H + 1], vnew[HRES*H];   // the old DOWN writes a byte after the VRAM
+
+// shift() before the word moves
+__attribute__((noinline)) static void old_shift(uint8_t* _screen, uint8_t distance, uint8_t direction) {
+  const int16_t _hres = HRES, _vres = H;
+  uint8_t * src;
+  uint8_t * dst;
+  uint8_t * end;
+  uint8_t shift;
+  uint8_t tmp;
+  switch(direction) {
+    case UP:
+      dst = _screen;
+      src = _screen + distance*_hres;
+      end = _screen + _vres*_hres;
+      while (src <  end) {
+        *dst = *src;
+        *src = 0;
+        dst++;
+        src++;
+      }
+      break;
+    case DOWN:
+      dst = _screen + _vres*_hres;
+      src = dst - distance*_hres;
+      end = _screen;
+      while (src >= end) {
+        *dst = *src;
+        *src = 0;
+        dst--;
+        src--;
+      }
+      break;
+    case LEFT:
+      shift = distance & 7;
+      for (uint8_t line = 0; line < _vres; line++) {
+        dst = _screen + _hres*line;
+        src = dst + distance/8;
+        end = dst + _hres-2;
+        while (src <= end) {
+          tmp = *src << shift;
+          *src = 0;
+          src++;
+          tmp |= *src >> (8 - shift);
+          *dst = tmp;
+          dst++;
+        }
+        tmp = *src << shift;
+        *src = 0;
+        *dst = tmp;
+      }
+      break;
+    case RIGHT:
+      shift = distance & 7;
+      for (uint8_t line = 0; line < _vres; line++) {
+        dst = _screen + _hres-1 + _hres*line;
+        src = dst - distance/8;
+        end = dst - _hres+2;
+        while (src >= end) {
+          tmp = *src >> shift;
+          *src = 0;
+          src--;
+          tmp |= *src << (8 - shift);
+          *dst = tmp;
+          dst--;
+        }
+        tmp = *src >> shift;
+        *src = 0;
+        *dst = tmp;
+      }
+      break;
+  }
+}
+
+static void pattern() {
+  for (int i = 0; i < HRES*H; i++)
+    vold[i] = vnew[i] = (uint8_t)(i * 7 + (i >> 5));
+}
+
+int main() {
+  static const struct { uint8_t dir, dist; const char* name; } t[] = {
+    { LEFT, 1, "shift LEFT 1" }, { LEFT, 3, "shift LEFT 3" }, { RIGHT, 1, "shift RIGHT 1" },
+    { UP, 1, "shift UP 1" }, { UP, 8, "shift UP 8" }, { DOWN, 1, "shift DOWN 1" },
+  };
+  TTVout tv;
+  double t0, t1;
+  int bad = 0;
+
+  tv.begin(SC_448x216, 1, vnew);
+  printf("448 x 216, 1 call\n");
+  for (uint8_t i = 0; i < sizeof(t)/sizeof(t[0]); i++) {
+    t0 = bench_us(2000, [&] { old_shift(vold, t[i].dist, t[i].dir); });
+    t1 = bench_us(2000, [&] { tv.shift(t[i].dist, t[i].dir); });
+    bench_print(t[i].name, t0, t1);
+    // Both must leave the same dots
+    pattern();
+    old_shift(vold, t[i].dist, t[i].dir);
+    tv.shift(t[i].dist, t[i].dir);
+    if (memcmp(vold, vnew, sizeof(vnew))) {
+      printf("FAILED: %s, the dots differ\n", t[i].name);
+      bad++;
+    }
+  }
+  // A pane of 448 x 100 dots, only shift_rect() can scroll it
+  t1 = bench_us(2000, [&] { tv.shift_rect(0, 50, W, 100, 1, LEFT); });
+  printf("%-28s %10.3f us\n", "shift_rect 448x100 LEFT 1", t1);
+  t1 = bench_us(2000, [&] { tv.shift_rect(0, 50, W, 100, 1, UP); });
+  printf("%-28s %10.3f us\n", "shift_rect 448x100 UP 1", t1);
+  t1 = bench_us(2000, [&] { tv.shift_rect(5, 50, W - 10, 100, 1, UP); });
+  printf("%-28s %10.3f us\n", "shift_rect 438x100 UP 1", t1);
+  return bad;
+}
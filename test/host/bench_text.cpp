@@ -0,0 +1,64 @@
+// Host benchmark of outlined text (set_text_style(TEXT_OUTLINE)) against
+// drawing the outline by bitblt(): the glyph cleared at the 8 neighbouring
+// dots (BLT_ANDNOT), then drawn (BLT_OR). A string of 22 characters on
+// 448 x 216 in each font.
+//
+// Build and run from the repository root:
+//   g++ -O2 -fno-tree-vectorize -std=gnu++11 -I test/host -I . test/host/bench_text.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp font4x6.cpp font6x8.cpp font8x8.cpp font8x8ext.cpp -o bench_text && ./bench_text
+#include "TTVout.h"
+#include "fontALL.h"
+#include "bench.h"
+
+static uint8_t vram[56*216];
+static TTVout tv;
+static const char str[] = "ALT 1234.5m SPD 87km/h";
+
+// Outlined string by 9 bitblt() a glyph
+static void naive_outline(const unsigned char* f, int16_t x, int16_t y, const char* s) {
+  uint8_t fw = f[0], fh = f[1], bw = (fw + 7) / 8;
+  for (; *s; s++, x += fw) {
+    const uint8_t* g = f + 3 + (uint8_t)(*s - f[2]) * fh * bw;
+    for (int8_t dy = -1; dy <= 1; dy++)
+      for (int8_t dx = -1; dx <= 1; dx++)
+        if (dx || dy)
+          tv.bitblt(x + dx, y + dy, g, bw, 0, 0, fw, fh, BLT_ANDNOT);
+    tv.bitblt(x, y, g, bw, 0, 0, fw, fh, BLT_OR);
+  }
+}
+
+int main() {
+  static const unsigned char* fonts[] = { font4x6, font6x8, font8x8, font8x8ext };
+  static const char* font_name[] = { "font4x6", "font6x8", "font8x8", "font8x8ext" };
+  static uint8_t naive_vram[sizeof(vram)];
+  char name[32];
+  double t0, t1;
+  int bad = 0;
+
+  tv.begin(SC_448x216, 1, vram);
+  printf("%d characters, 1 call\n", (int)strlen(str));
+  for (uint8_t i = 0; i < 4; i++) {
+    const unsigned char* f = fonts[i];
+    tv.select_font(f);
+    t0 = bench_us(5000, [&] { naive_outline(f, 11, 20, str); });
+    tv.set_text_style(TEXT_OUTLINE);
+    t1 = bench_us(5000, [&] { tv.print(11, 20, str); });
+    tv.set_text_style(TEXT_NORMAL);
+    sprintf(name, "outline %s", font_name[i]);
+    bench_print(name, t0, t1);
+
+    // Both must draw the same dots on a gray background
+    memset(vram, 0x55, sizeof(vram));
+    naive_outline(f, 11, 20, str);
+    memcpy(naive_vram, vram, sizeof(vram));
+    memset(vram, 0x55, sizeof(vram));
+    tv.set_text_style(TEXT_OUTLINE);
+    tv.print(11, 20, str);
+    tv.set_text_style(TEXT_NORMAL);
+    if (memcmp(naive_vram, vram, sizeof(vram))) {
+      printf("FAILED: %s, the dots differ\n", name);
+      bad++;
+    }
+  }
+  return bad;
+}
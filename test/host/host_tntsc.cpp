@@ -0,0 +1,107 @@
+// TNTSC stand-in for host builds of TTVout
+// begin() sets up the VRAM of the 72 MHz screen modes like the real driver
+// (SC_DMA16: word aligned lines, bytes of each half word swapped, SC_GPIO
+// modes: 2 bits per dot of the 4 gray level mode) but nothing
+// is displayed, the VRAM operations are done at once and time is wall clock.
+#include <sys/time.h>
+#include "TNTSC.h"
+
+HardwareTimer Timer4;
+TNTSC_class TNTSC;
+
+static const uint16_t host_type[][3] = {
+ //width height hsize
+  { 112, 108, 14 }, // SC_112x108
+  { 224, 108, 28 }, // SC_224x108
+  { 224, 216, 28 }, // SC_224x216
+  { 448, 108, 56 }, // SC_448x108
+  { 448, 216, 56 }, // SC_448x216
+};
+static const uint16_t host_gpio[][4] = {
+ //width height hsize bpp
+  { 360, 108, 45, 1 }, // SC_360x108G
+  { 360, 216, 45, 1 }, // SC_360x216G
+  { 400, 108, 50, 1 }, // SC_400x108G
+  { 400, 216, 50, 1 }, // SC_400x216G
+  { 200, 216, 50, 2 }, // SC_200x216G4
+};
+static uint8_t* vram;
+static uint16_t _width, _height, _stride;
+static uint8_t  _dma16, _bpp;
+
+uint32_t micros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint32_t)(tv.tv_sec * 1000000ULL + tv.tv_usec);
+}
+uint32_t millis() { return micros() / 1000; }
+void delay(uint32_t) {}
+
+void TNTSC_class::begin(uint8_t mode, uint8_t, uint8_t* extram) {
+  uint8_t no = mode & ~(SC_GPIO|SC_DMA16);
+  if (mode & SC_GPIO) {
+    if (no >= sizeof(host_gpio)/sizeof(host_gpio[0]))
+      no = 0;
+    _width = host_gpio[no][0];
+    _height = host_gpio[no][1];
+    _stride = host_gpio[no][2];
+    _bpp = host_gpio[no][3];
+    _dma16 = 0;
+  } else {
+    if (no >= sizeof(host_type)/sizeof(host_type[0]))
+      no = SC_DEFAULT;
+    _width = host_type[no][0];
+    _height = host_type[no][1];
+    _dma16 = (mode & SC_DMA16) ? 1 : 0;
+    _stride = _dma16 ? (host_type[no][2] + 3) & ~3 : host_type[no][2];
+    _bpp = 1;
+  }
+  flgExtVram = extram != NULL;
+  vram = extram ? extram : (uint8_t*)malloc(_stride * _height);
+  cls();
+}
+void TNTSC_class::end() {
+  if (!flgExtVram)
+    free(vram);
+  vram = NULL;
+}
+uint8_t* TNTSC_class::VRAM() { return vram; }
+void TNTSC_class::cls() { memset(vram, 0, _stride * _height); }
+void TNTSC_class::delay_frame(uint16_t) {}
+void TNTSC_class::delay(uint32_t) {}
+void TNTSC_class::setIdleMode(uint8_t) {}
+void TNTSC_class::setBktmStartHook(void (*)()) {}
+void TNTSC_class::setBktmEndHook(void (*)()) {}
+void TNTSC_class::adjust(int16_t) {}
+uint16_t TNTSC_class::width() { return _width; }
+uint16_t TNTSC_class::height() { return _height; }
+uint16_t TNTSC_class::vram_size() { return _stride * _height; }
+uint8_t TNTSC_class::bpp() { return _bpp; }
+uint16_t TNTSC_class::stride() { return _stride; }
+uint8_t TNTSC_class::byteSwap() { return _dma16; }
+
+// VRAM operations are done at once, done() is called before returning
+bool TNTSC_class::fillAsync(uint16_t y, uint16_t lines, uint8_t pat, void (*done)(), uint8_t) {
+  if (y >= _height)
+    lines = 0;
+  else if (y + lines > _height)
+    lines = _height - y;
+  memset(vram + y*_stride, pat, lines*_stride);
+  if (done)
+    done();
+  return true;
+}
+bool TNTSC_class::moveAsync(uint16_t dy, uint16_t sy, uint16_t lines, void (*done)(), uint8_t) {
+  uint16_t y = dy > sy ? dy : sy;
+  if (y >= _height)
+    lines = 0;
+  else if (y + lines > _height)
+    lines = _height - y;
+  memmove(vram + dy*_stride, vram + sy*_stride, lines*_stride);
+  if (done)
+    done();
+  return true;
+}
+uint8_t TNTSC_class::asyncFree() { return NTSC_VOP_QUEUE - 1; }
+bool TNTSC_class::asyncBusy() { return false; }
+void TNTSC_class::asyncWait() {}
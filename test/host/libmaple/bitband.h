@@ -0,0 +1,4 @@
+// libmaple/bitband.h for host builds
+// No host address maps to the SRAM bit band, TTVout draws with byte masks.
+#define BB_SRAM_REF   0x20000000
+#define BB_SRAM_BASE  0x22000000
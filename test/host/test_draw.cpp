@@ -0,0 +1,698 @@
+// Host test of TTVout drawing into plain byte arrays
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -I test/host -I . test/host/test_draw.cpp test/host/host_tntsc.cpp
+//       TTVout.cpp font4x6.cpp font6x8.cpp font8x8.cpp font8x8ext.cpp -o test_draw && ./test_draw
+// The exit status is the number of failed checks.
+#include <stdio.h>
+#include "TTVout.h"
+#include "fontALL.h"
+
+static int fails = 0;
+#define CHECK(e) do { if (!(e)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #e); fails++; } } while (0)
+
+// Dot (x,y) of a 1bpp bitmap (bswap: bytes of each half word swapped)
+static int dot(const uint8_t* buf, int stride, int bswap, int x, int y) {
+  return (buf[y*stride + ((x >> 3) ^ bswap)] >> (7 - (x & 7))) & 1;
+}
+
+static int count_dots(const uint8_t* buf, int stride, int bswap, int w, int h) {
+  int n = 0;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      n += dot(buf, stride, bswap, x, y);
+  return n;
+}
+
+// 4 gray level mode: 200 dots of 2 bits (hres() counts the bits), the bits
+// of set_gray() and get_gray(), clipping
+static void test_gray() {
+  TTVout tv;
+  tv.begin(SC_200x216G4, 1, NULL);
+  uint8_t* v = tv.VRAM();
+  CHECK(tv.hres() == 400 && tv.vres() == 216);
+  for (int x = 0; x < 200; x++)
+    tv.set_gray(x, 3, x & 3);
+  for (int x = 0; x < 200; x++)
+    CHECK(tv.get_gray(x, 3) == (x & 3));
+  CHECK(v[3*50] == 0x1b && v[3*50 + 49] == 0x1b);   // levels 0,1,2,3 MSB first
+  CHECK(count_dots(v, 50, 0, 400, 216) == 200);
+  tv.set_gray(200, 3, 3);
+  tv.set_gray(-1, 3, 3);
+  tv.setClipRect(10, 0, 20, 216);                   // dots 5..14
+  for (int x = 4; x < 16; x++)
+    tv.set_gray(x, 5, 2);
+  tv.resetClipRect();
+  CHECK(tv.get_gray(4, 5) == 0 && tv.get_gray(5, 5) == 2 && tv.get_gray(14, 5) == 2 && tv.get_gray(15, 5) == 0);
+  CHECK(tv.get_gray(200, 3) == 0 && tv.get_gray(0, 216) == 0);
+  CHECK(count_dots(v, 50, 0, 400, 216) == 200 + 10);
+  tv.end();
+}
+
+static void scene(TTVout& tv) {
+  tv.select_font(font6x8);
+  tv.draw_rect(3, 5, 50, 20, WHITE, WHITE);
+  tv.draw_rect(10, 8, 30, 10, INVERT, INVERT);
+  tv.draw_line(0, 100, 223, 40, WHITE);
+  tv.draw_circle(120, 120, 40, WHITE, -1);
+  tv.print(17, 150, "Hello, world");
+  tv.set_pixel(223, 215, WHITE);
+}
+
+// SC_DMA16 VRAM holds the same dots with the bytes of each half word swapped
+static void test_dma16() {
+  static uint8_t v8[28*216], v16[28*216];
+  TTVout a, b;
+  a.begin(SC_224x216, 1, v8);
+  b.begin(SC_224x216 | SC_DMA16, 1, v16);
+  scene(a);
+  scene(b);
+  CHECK(count_dots(v8, 28, 0, 224, 216) > 1000);
+  for (int y = 0; y < 216; y++)
+    for (int x = 0; x < 224; x++)
+      CHECK(dot(v8, 28, 0, x, y) == dot(v16, 28, 1, x, y));
+}
+
+// Filled rectangle of w x h dots, clipping and the dots around it
+static void test_rect() {
+  static uint8_t vram[28*216];
+  TTVout tv;
+  tv.begin(SC_224x216, 1, vram);
+  CHECK(tv.VRAM() == vram);
+  CHECK(tv.hres() == 224 && tv.vres() == 216);
+  tv.draw_rect(5, 2, 20, 3, WHITE, WHITE);
+  for (int y = 0; y < 8; y++)
+    for (int x = 0; x < 32; x++)
+      CHECK(dot(vram, 28, 0, x, y) == (x >= 5 && x < 25 && y >= 2 && y < 5));
+  CHECK(tv.get_pixel(5, 2) == 1 && tv.get_pixel(4, 2) == 0);
+  tv.setClipRect(0, 0, 10, 10);
+  tv.draw_rect(0, 20, 100, 100, WHITE, WHITE);
+  tv.resetClipRect();
+  CHECK(count_dots(vram, 28, 0, 224, 216) == 20*3);
+  tv.fill(WHITE);
+  CHECK(count_dots(vram, 28, 0, 224, 216) == 224*216);
+}
+
+static uint32_t seed = 1;
+static int rnd(int n) {
+  seed = seed * 1103515245u + 12345u;
+  return (int)((seed >> 8) % (uint32_t)n);
+}
+
+// Dots of the screen drawn by tv, a byte a dot
+static void screen_dots(TTVout& tv, uint8_t* d) {
+  for (int y = 0; y < tv.vres(); y++)
+    for (int x = 0; x < tv.hres(); x++)
+      *d++ = tv.get_pixel(x, y);
+}
+
+static uint8_t dots_a[448*216], dots_b[448*216], dots_c[448*216];
+
+// Lines of 14 bytes (not whole words): shift_rect() and text runs must not
+// touch the bytes after a line, the last line ends the VRAM (build with
+// -fsanitize=address to see reads and writes past it). The VRAM starts 2 bytes
+// after a word boundary, so the last line starts at one. The dots must be the
+// same as with the lines of 16 bytes of SC_DMA16.
+static void test_line_end() {
+  static uint8_t b[16*108];
+  static const uint8_t dir[4] = { UP, DOWN, LEFT, RIGHT };
+  uint8_t* m = (uint8_t*)malloc(2 + 14*108);
+  uint8_t* a = m + 2;
+  TTVout ta, tb;
+  ta.begin(SC_112x108, 1, a);
+  tb.begin(SC_112x108 | SC_DMA16, 1, b);
+  for (int y = 0; y < 108; y++)
+    for (int i = 0; i < 14; i++)
+      a[y*14 + i] = b[y*16 + (i ^ 1)] = (uint8_t)(y * 37 + i * 11 + 5);
+  for (int k = 0; k < 2; k++) {
+    TTVout& tv = k ? tb : ta;
+    tv.select_font(font6x8);
+    for (int i = 0; i < 8; i++) {
+      tv.shift_rect(i * 5, 99, 112 - i * 5, 9, 1 + i * 3, dir[i & 3]);
+      tv.print(112 - 6 * (i + 2) - i, 100, "ABCDEFGHIJ");
+    }
+    tv.set_text_style(TEXT_OUTLINE);
+    tv.print(70, 99, "XYZ");
+    tv.set_text_style(TEXT_NORMAL);
+  }
+  for (int y = 0; y < 108; y++)
+    for (int x = 0; x < 112; x++)
+      CHECK(dot(a, 14, 0, x, y) == dot(b, 16, 1, x, y));
+  free(m);
+}
+
+// shift_rect() against the dots moved one by one, 448 dots of whole words
+// (whole lines are one run of words), with and without byte swap
+static void test_shift() {
+  static uint8_t vram[56*216];
+  static const uint8_t dir[4] = { UP, DOWN, LEFT, RIGHT };
+  TTVout tv;
+  for (int k = 0; k < 64; k++) {
+    tv.begin(k & 1 ? SC_448x216 | SC_DMA16 : SC_448x216, 1, vram);
+    for (int i = 0; i < (int)sizeof(vram); i++)
+      vram[i] = rnd(256);
+    int x = k & 2 ? -rnd(3) : rnd(100) - 20, y = rnd(60) - 10;
+    int w = k & 2 ? 448 - x : rnd(440) + 1, h = rnd(220) + 1;
+    int d = rnd(4) ? rnd(40) + 1 : rnd(300) + 1, r = k & 4 ? 2 + (k >> 3 & 1) : rnd(4);
+    int x0 = x < 0 ? 0 : x, y0 = y < 0 ? 0 : y;
+    int x1 = x + w > 448 ? 448 : x + w, y1 = y + h > 216 ? 216 : y + h;
+    screen_dots(tv, dots_c);
+    memcpy(dots_b, dots_c, sizeof(dots_b));
+    for (int v = y0; v < y1; v++)
+      for (int u = x0; u < x1; u++) {
+        int su = u + (dir[r] == LEFT ? d : dir[r] == RIGHT ? -d : 0);
+        int sv = v + (dir[r] == UP ? d : dir[r] == DOWN ? -d : 0);
+        dots_b[v*448 + u] = su >= x0 && su < x1 && sv >= y0 && sv < y1 ? dots_c[sv*448 + su] : 0;
+      }
+    tv.shift_rect(x, y, w, h, d, dir[r]);
+    screen_dots(tv, dots_a);
+    CHECK(memcmp(dots_a, dots_b, sizeof(dots_a)) == 0);
+  }
+}
+
+// Strings drawn with a glyph cache (some characters cached, few slots) as without it
+static void test_glyph_cache() {
+  static uint8_t buf[200];
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  tv.select_font(font6x8);
+  for (int k = 0; k < 2; k++) {
+    memset(tv.VRAM(), 0x5a, 28*20);
+    tv.set_glyph_cache(k ? buf : NULL, sizeof(buf), "0123456789.");
+    tv.setClipRect(3, 1, 200, 17);
+    for (int i = 0; i < 8; i++)
+      tv.print(i * 3 - 5, (i & 3) * 4, "ALT 1234.5m 0.42 x9");
+    tv.resetClipRect();
+    screen_dots(tv, k ? dots_b : dots_a);
+  }
+  tv.set_glyph_cache(NULL, 0);
+  CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+  tv.end();
+}
+
+// The dots of f() are the dots of print(s), a '|' after both shows the width
+template <class F> static bool prints(TTVout& tv, F f, const char* s) {
+  tv.cls();
+  tv.set_cursor(0, 0);
+  f();
+  tv.print("|");
+  screen_dots(tv, dots_a);
+  tv.cls();
+  tv.print(0, 0, s);
+  tv.print("|");
+  screen_dots(tv, dots_b);
+  return memcmp(dots_a, dots_b, 224*216) == 0;
+}
+#define PRINTS(call, s)  CHECK(prints(tv, [&] { tv.call; }, s))
+
+// print_dec() and print_fix(): signs, -0.x, rounding carry, padding and alignment
+static void test_print() {
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  tv.select_font(font6x8);
+  PRINTS(print_dec(0), "0");
+  PRINTS(print_dec(-1234, 2), "-12.34");
+  PRINTS(print_dec(-5, 1), "-0.5");
+  PRINTS(print_dec(7, 3), "0.007");
+  PRINTS(print_dec(-2147483647L - 1), "-2147483648");
+  PRINTS(print_fix(-16384, 16, 2), "-0.25");
+  PRINTS(print_fix(65470, 16, 2), "1.00");          // 0.999
+  PRINTS(print_fix(-65470, 16, 2), "-1.00");
+  PRINTS(print_fix(0x1ffff, 16, 4), "2.0000");     // 1.99998
+  PRINTS(print_fix(3*65536 + 32768, 16, 0), "4");
+  PRINTS(print_fix(5, 0, 2), "5.00");
+  PRINTS(print_dec(42, 0, 5), "   42");
+  PRINTS(print_dec(-42, 0, 5), "  -42");
+  PRINTS(print_dec(-42, 0, 6, '0'), "-00042");
+  PRINTS(print_dec(-42, 1, 7, '0'), "-0004.2");
+  PRINTS(print_fix(-16384, 16, 1, 6, '0'), "-000.3");
+  PRINTS(print_dec(123, 1, -7), "12.3   ");
+  PRINTS(print_dec(-5, 1, -6), "-0.5  ");
+  PRINTS(print_dec(123456, 0, 3), "123456");        // wider than the field
+  tv.end();
+}
+
+// Dots of a drawn with the clip rectangle x0,y0 - x1,y1 are the dots of b inside
+// of it and the dots of c (the screen before drawing) outside
+static bool clipped_as(const uint8_t* a, const uint8_t* b, const uint8_t* c, int x0, int y0, int x1, int y1) {
+  for (int y = 0; y < 216; y++)
+    for (int x = 0; x < 224; x++) {
+      int in = x >= x0 && x <= x1 && y >= y0 && y <= y1;
+      if (a[y*224 + x] != (in ? b : c)[y*224 + x])
+        return false;
+    }
+  return true;
+}
+
+// Background of the clipping tests: a few inverted rectangles
+static void background(TTVout& tv) {
+  tv.cls();
+  for (int i = 0; i < 6; i++)
+    tv.draw_rect(rnd(224), rnd(216), rnd(100) + 1, rnd(100) + 1, INVERT, INVERT);
+}
+
+// A random clip rectangle set to tv, x0,y0 - x1,y1: its dots
+static void random_clip(TTVout& tv, int& x0, int& y0, int& x1, int& y1) {
+  int w = rnd(150) + 1, h = rnd(150) + 1;
+  x0 = rnd(150);
+  y0 = rnd(150);
+  tv.setClipRect(x0, y0, w, h);
+  x1 = x0 + w > 224 ? 223 : x0 + w - 1;
+  y1 = y0 + h > 216 ? 215 : y0 + h - 1;
+}
+
+// fill_polygon(): a rectangle as draw_rect(), the clip rectangle, INVERT twice
+static void test_polygon() {
+  static const uint8_t col[3] = { WHITE, BLACK, INVERT };
+  static uint8_t save[28*216];
+  int16_t p[2*12];
+  int x0, y0, x1, y1;
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  for (int k = 0; k < 40; k++) {
+    int x = rnd(260) - 20, y = rnd(250) - 20, w = rnd(100) + 1, h = rnd(100) + 1;
+    int16_t r[8] = { (int16_t)x, (int16_t)y, (int16_t)(x + w), (int16_t)y,
+                     (int16_t)(x + w), (int16_t)(y + h), (int16_t)x, (int16_t)(y + h) };
+    tv.cls();
+    tv.fill_polygon(r, 4, WHITE);
+    screen_dots(tv, dots_a);
+    tv.cls();
+    tv.draw_rect(x, y, w, h, WHITE, WHITE);
+    screen_dots(tv, dots_b);
+    CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+  }
+  for (int k = 0; k < 60; k++) {
+    int n = rnd(10) + 3;
+    uint8_t c = col[rnd(3)];
+    for (int i = 0; i < n; i++) {
+      p[2*i] = rnd(300) - 40;
+      p[2*i + 1] = rnd(290) - 40;
+    }
+    background(tv);
+    memcpy(save, tv.VRAM(), sizeof(save));
+    screen_dots(tv, dots_c);
+    tv.fill_polygon(p, n, c);
+    screen_dots(tv, dots_b);
+    memcpy(tv.VRAM(), save, sizeof(save));
+    random_clip(tv, x0, y0, x1, y1);
+    tv.fill_polygon(p, n, c);
+    tv.resetClipRect();
+    screen_dots(tv, dots_a);
+    CHECK(clipped_as(dots_a, dots_b, dots_c, x0, y0, x1, y1));
+    tv.cls();
+    tv.fill_polygon(p, n, INVERT);
+    tv.fill_polygon(p, n, INVERT);
+    CHECK(count_dots(tv.VRAM(), 28, 0, 224, 216) == 0);
+  }
+  tv.end();
+}
+
+// Curve k of test_curves() (v: random numbers)
+static void draw_curve(TTVout& tv, int k, const int* v, uint8_t c, int8_t fc) {
+  switch (k % 3) {
+    case 0: tv.draw_ellipse(v[0], v[1], v[2], v[3], c, fc); break;
+    case 1: tv.draw_arc(v[0], v[1], v[2], v[3], v[4] - 360, v[5] - 360, c, fc); break;
+    case 2: tv.draw_rrect(v[0] - 60, v[1] - 60, v[2] * 2 + 1, v[3] * 2 + 1, v[4] % 40, c, fc); break;
+  }
+}
+
+// draw_ellipse(), draw_arc() and draw_rrect(): clipped as unclipped inside of the
+// clip rectangle, INVERT twice
+static void test_curves() {
+  static const uint8_t col[3] = { WHITE, BLACK, INVERT };
+  static uint8_t save[28*216];
+  int v[6], x0, y0, x1, y1;
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  for (int k = 0; k < 90; k++) {
+    uint8_t c = col[rnd(3)];
+    int8_t fc = rnd(2) ? -1 : col[rnd(3)];
+    v[0] = rnd(280) - 30;
+    v[1] = rnd(270) - 30;
+    v[2] = rnd(100);
+    v[3] = rnd(100);
+    v[4] = rnd(1080);
+    v[5] = rnd(1080);
+    background(tv);
+    memcpy(save, tv.VRAM(), sizeof(save));
+    screen_dots(tv, dots_c);
+    draw_curve(tv, k, v, c, fc);
+    screen_dots(tv, dots_b);
+    memcpy(tv.VRAM(), save, sizeof(save));
+    random_clip(tv, x0, y0, x1, y1);
+    draw_curve(tv, k, v, c, fc);
+    tv.resetClipRect();
+    screen_dots(tv, dots_a);
+    CHECK(clipped_as(dots_a, dots_b, dots_c, x0, y0, x1, y1));
+    tv.cls();
+    draw_curve(tv, k, v, INVERT, fc < 0 ? -1 : INVERT);
+    draw_curve(tv, k, v, INVERT, fc < 0 ? -1 : INVERT);
+    CHECK(count_dots(tv.VRAM(), 28, 0, 224, 216) == 0);
+  }
+  tv.end();
+}
+
+// draw_polyline(): INVERT of width 1 inverts the joints once, a stroke stays
+// within its bounding box and the width, clipped as unclipped inside of the clip rectangle
+static void test_stroke() {
+  static uint8_t save[28*216];
+  int16_t p[2*10];
+  int x0, y0, x1, y1;
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  for (int k = 0; k < 40; k++) {
+    // Lines of at most one dot a column from left to right: only the joints are shared
+    int n = rnd(9) + 2;
+    p[0] = rnd(20);
+    p[1] = rnd(216);
+    for (int i = 1; i < n; i++) {
+      int dx = rnd(10) + 10, dy = rnd(2*dx + 1) - dx;
+      p[2*i] = p[2*i - 2] + dx;
+      p[2*i + 1] = p[2*i - 1] + (p[2*i - 1] + dy < 0 || p[2*i - 1] + dy > 215 ? -dy : dy);
+    }
+    tv.cls();
+    tv.draw_polyline(p, n, WHITE);
+    screen_dots(tv, dots_b);
+    tv.cls();
+    tv.draw_polyline(p, n, INVERT);
+    screen_dots(tv, dots_a);
+    CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+  }
+  for (int k = 0; k < 60; k++) {
+    int n = rnd(6) + 2, width = rnd(12) + 1, join = rnd(2) ? JOIN_MITER : JOIN_BEVEL;
+    int bx0 = 224, by0 = 216, bx1 = 0, by1 = 0;
+    int m = join == JOIN_MITER ? width + 1 : width / 2 + 1;   // a miter is up to 2 half widths
+    for (int i = 0; i < n; i++) {
+      p[2*i] = rnd(140) + 40;
+      p[2*i + 1] = rnd(130) + 40;
+      if (p[2*i] < bx0) bx0 = p[2*i];
+      if (p[2*i] > bx1) bx1 = p[2*i];
+      if (p[2*i + 1] < by0) by0 = p[2*i + 1];
+      if (p[2*i + 1] > by1) by1 = p[2*i + 1];
+    }
+    tv.cls();
+    tv.draw_polyline(p, n, WHITE, width, join);
+    screen_dots(tv, dots_b);
+    int out = 0;
+    for (int y = 0; y < 216; y++)
+      for (int x = 0; x < 224; x++)
+        if (dots_b[y*224 + x] && (x < bx0 - m || x > bx1 + m || y < by0 - m || y > by1 + m))
+          out++;
+    CHECK(out == 0);
+    background(tv);
+    memcpy(save, tv.VRAM(), sizeof(save));
+    screen_dots(tv, dots_c);
+    tv.draw_polyline(p, n, k & 1 ? INVERT : WHITE, width, join);
+    screen_dots(tv, dots_b);
+    memcpy(tv.VRAM(), save, sizeof(save));
+    random_clip(tv, x0, y0, x1, y1);
+    tv.draw_polyline(p, n, k & 1 ? INVERT : WHITE, width, join);
+    tv.resetClipRect();
+    screen_dots(tv, dots_a);
+    CHECK(clipped_as(dots_a, dots_b, dots_c, x0, y0, x1, y1));
+  }
+  tv.end();
+}
+
+// Patterned rectangle: negative w, h and clipping as solid ones, the dots of the pattern
+static void test_pattern_rect() {
+  static uint8_t vram[28*216];
+  TTVout tv;
+  tv.begin(SC_224x216, 1, vram);
+  tv.set_pattern(PAT_GRAY50);
+  tv.draw_rect(40, 30, -20, -10, WHITE, WHITE);
+  for (int y = 0; y < 40; y++)
+    for (int x = 0; x < 48; x++)
+      CHECK(dot(vram, 28, 0, x, y) == (x >= 20 && x < 40 && y >= 20 && y < 30 && !((x + y) & 1)));
+  tv.draw_rect(40, 30, -20, -10, INVERT, INVERT);
+  CHECK(count_dots(vram, 28, 0, 224, 216) == 0);
+  tv.setClipRect(0, 0, 10, 10);
+  tv.draw_rect(4, 4, 100, -100, WHITE, WHITE);
+  tv.resetClipRect();
+  CHECK(count_dots(vram, 28, 0, 224, 216) == 6*4/2);
+  tv.set_pattern(NULL);
+}
+
+// flood_fill() of 4 connected dots within the clip rectangle of a w x h dot array
+static void ref_fill(uint8_t* d, int w, int x, int y, uint8_t c, int x0, int y0, int x1, int y1) {
+  static int16_t stk[2*224*216];
+  static const int dx[4] = { 1, -1, 0, 0 }, dy[4] = { 0, 0, 1, -1 };
+  int n = 0;
+  uint8_t t = d[y*w + x];
+  if (c == INVERT)
+    c = !t;
+  if (c == t)
+    return;
+  d[y*w + x] = c;
+  stk[n++] = x;
+  stk[n++] = y;
+  while (n) {
+    y = stk[--n];
+    x = stk[--n];
+    for (int i = 0; i < 4; i++) {
+      int u = x + dx[i], v = y + dy[i];
+      if (u < x0 || u > x1 || v < y0 || v > y1 || d[v*w + u] != t)
+        continue;
+      d[v*w + u] = c;   // each dot is pushed once
+      stk[n++] = u;
+      stk[n++] = v;
+    }
+  }
+}
+
+// flood_fill() against the reference, areas ending at the last dot of the lines
+// and of the VRAM (224 dots: no byte after a line), a seed stack too small
+static void test_flood_fill() {
+  static uint8_t seeds[4*1024], few[4*3];
+  static const uint8_t col[3] = { WHITE, BLACK, INVERT };
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);   // VRAM of the exact size
+  for (int k = 0; k < 40; k++) {
+    int cx = 0, cy = 0, cw = 224, ch = 216;
+    tv.fill(k & 1 ? WHITE : BLACK);
+    for (int i = 0; i < 12; i++) {
+      tv.draw_rect(rnd(260) - 20, rnd(250) - 20, rnd(120) + 2, rnd(120) + 2, INVERT);
+      tv.draw_circle(rnd(224), rnd(216), rnd(60) + 1, INVERT);
+      tv.draw_line(rnd(224), rnd(216), rnd(224), rnd(216), INVERT);
+    }
+    if (k & 2) {
+      cx = rnd(40);
+      cy = rnd(40);
+      cw = 224 - cx - rnd(2) * rnd(40);
+      ch = 216 - cy - rnd(2) * rnd(40);
+      tv.setClipRect(cx, cy, cw, ch);
+    }
+    for (int i = 0; i < 4; i++) {
+      int x = cx + rnd(cw), y = cy + rnd(ch);
+      uint8_t c = col[rnd(3)];
+      screen_dots(tv, dots_b);
+      ref_fill(dots_b, 224, x, y, c, cx, cy, cx + cw - 1, cy + ch - 1);
+      CHECK(tv.flood_fill(x, y, c, seeds, sizeof(seeds)));
+      screen_dots(tv, dots_a);
+      CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+    }
+    tv.resetClipRect();
+  }
+
+  // The whole screen, then an area along the right end and the last line
+  tv.fill(BLACK);
+  CHECK(tv.flood_fill(100, 100, WHITE));
+  CHECK(tv.get_pixel(0, 0) && tv.get_pixel(223, 215));
+  tv.draw_rect(0, 0, 200, 200, BLACK, BLACK);
+  CHECK(tv.flood_fill(223, 0, INVERT));
+  CHECK(!tv.get_pixel(223, 215) && !tv.get_pixel(0, 215) && !tv.get_pixel(0, 0));
+
+  // A comb: one run a tooth on each line, 3 seeds are too few
+  tv.fill(BLACK);
+  for (int x = 1; x < 224; x += 2)
+    tv.draw_line(x, 1, x, 215, WHITE);
+  CHECK(!tv.flood_fill(0, 0, WHITE, few, 3));   // no seed fits
+  CHECK(!tv.get_pixel(0, 0));
+  CHECK(!tv.flood_fill(0, 0, WHITE, few, sizeof(few)));
+  tv.fill(BLACK);
+  for (int x = 1; x < 224; x += 2)
+    tv.draw_line(x, 1, x, 215, WHITE);
+  CHECK(tv.flood_fill(0, 0, WHITE, seeds, sizeof(seeds)));
+  tv.end();
+}
+
+// Dots of bitblt_scaled() of src (w x h dots) at x,y into d within x0,y0 - x1,y1
+static void ref_scaled(uint8_t* d, const uint8_t* src, int stride, int x, int y, int w, int h,
+                       int xs, int ys, uint8_t op, int x0, int y0, int x1, int y1) {
+  for (int j = 0; j < h*ys; j++)
+    for (int i = 0; i < w*xs; i++) {
+      int u = x + i, v = y + j;
+      if (u < x0 || u > x1 || v < y0 || v > y1)
+        continue;
+      uint8_t s = dot(src, stride, 0, i / xs, j / ys), *p = &d[v*224 + u];
+      switch (op) {
+        case BLT_COPY:   *p = s;   break;
+        case BLT_OR:     *p |= s;  break;
+        case BLT_AND:    *p &= s;  break;
+        case BLT_XOR:    *p ^= s;  break;
+        case BLT_ANDNOT: *p &= !s; break;
+      }
+    }
+}
+
+// bitblt_scaled(), bitmap_scaled() and print_char() xs x ys times larger (1..16)
+// against the dots of the source one by one, with a clip rectangle and the operations
+static void test_scaled() {
+  static uint8_t src[6*40], bmp[2 + 3*12];
+  static const uint8_t ops[5] = { BLT_COPY, BLT_OR, BLT_AND, BLT_XOR, BLT_ANDNOT };
+  int x0 = 0, y0 = 0, x1 = 223, y1 = 215;
+  TTVout tv;
+  tv.begin(SC_224x216, 1, NULL);
+  for (int xs = 1; xs <= 16; xs++)
+    for (int ys = 1; ys <= 16; ys++) {
+      int w = rnd(40) + 1, h = rnd(12) + 1, stride = (w + 7) / 8 + rnd(2);
+      int x = rnd(280) - 60, y = rnd(260) - 60;
+      uint8_t op = (xs + ys) & 2 ? BLT_XOR : ops[rnd(5)];
+      for (int i = 0; i < stride * h; i++)
+        src[i] = rnd(256);
+      background(tv);
+      screen_dots(tv, dots_b);
+      if ((xs ^ ys) & 1)
+        random_clip(tv, x0, y0, x1, y1);
+      else
+        x0 = y0 = 0, x1 = 223, y1 = 215;
+      ref_scaled(dots_b, src, stride, x, y, w, h, xs, ys, op, x0, y0, x1, y1);
+      tv.bitblt_scaled(x, y, src, stride, w, h, xs, ys, op);
+      tv.resetClipRect();
+      screen_dots(tv, dots_a);
+      CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+    }
+
+  // A bitmap of w, h and the lines, a character of the font
+  bmp[0] = 19;
+  bmp[1] = 12;
+  for (int i = 0; i < 3*12; i++)
+    bmp[2 + i] = rnd(256);
+  tv.select_font(font6x8);
+  for (int k = 0; k < 32; k++) {
+    int xs = rnd(16) + 1, ys = rnd(16) + 1, x = rnd(250) - 30, y = rnd(240) - 30;
+    uint8_t op = ops[rnd(5)], c = 'A' + rnd(26);
+    background(tv);
+    screen_dots(tv, dots_b);
+    ref_scaled(dots_b, bmp + 2, 3, x, y, 19, 12, xs, ys, op, 0, 0, 223, 215);
+    tv.bitmap_scaled(x, y, bmp, xs, ys, op);
+    screen_dots(tv, dots_a);
+    CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+    // The glyph as print_char() draws it, then scaled
+    tv.cls();
+    tv.print_char(0, 0, c);
+    for (int j = 0; j < 8; j++)
+      src[j] = tv.VRAM()[j*28];
+    background(tv);
+    screen_dots(tv, dots_b);
+    ref_scaled(dots_b, src, 1, x, y, 6, 8, xs, ys, BLT_COPY, 0, 0, 223, 215);
+    tv.print_char(x, y, c, xs, ys);
+    screen_dots(tv, dots_a);
+    CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+  }
+  tv.end();
+}
+
+// Drawing to an off-screen bitmap at an odd address, then blit() to the screen
+static void test_surface() {
+  static uint8_t vram[28*216];
+  static uint8_t mem[1 + 7*40];
+  Surface s = { mem + 1, 50, 40, 7, 0 };
+  TTVout tv;
+  tv.begin(SC_224x216, 1, vram);
+  tv.set_surface(&s);
+  CHECK(tv.hres() == 50 && tv.vres() == 40);
+  tv.draw_rect(-10, -10, 200, 200, WHITE, WHITE);
+  tv.draw_rect(10, 10, 9, 9, BLACK, BLACK);
+  tv.set_surface(NULL);
+  CHECK(mem[0] == 0);
+  CHECK(count_dots(vram, 28, 0, 224, 216) == 0);
+  CHECK(count_dots(mem + 1, 7, 0, 50, 40) == 50*40 - 9*9);
+  CHECK((mem[1 + 6] & 0x3f) == 0);   // padding dots of each line untouched
+  tv.blit(100, 100, s);
+  for (int y = 95; y < 145; y++)
+    for (int x = 95; x < 155; x++) {
+      int in = x >= 100 && x < 150 && y >= 100 && y < 140;
+      int hole = x >= 110 && x < 119 && y >= 110 && y < 119;
+      CHECK(dot(vram, 28, 0, x, y) == (in && !hole));
+    }
+}
+
+// Sprite of test_sprites() drawn into the dots d (mask NULL: all dots)
+static void ref_sprite(uint8_t* d, const uint8_t* image, const uint8_t* mask, int w, int h, int x, int y) {
+  int bw = (w + 7) / 8;
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++) {
+      int u = x + i, v = y + j;
+      if (u >= 0 && u < 224 && v >= 0 && v < 216 && (!mask || dot(mask, bw, 0, i, j)))
+        d[v*224 + u] = dot(image, bw, 0, i, j);
+    }
+}
+
+// Overlapping sprites are the masked images in the order of add_sprite() over
+// the background, removing all of them leaves the background, with and without byte swap
+static void test_sprites() {
+  static uint8_t vram[28*216], image[3][3*20], mask[3][3*20], save[3][SPRITE_SAVE_SIZE(24, 20)];
+  static const int sw[3] = { 13, 24, 7 }, sh[3] = { 9, 16, 20 };
+  Sprite s[3];
+  int x[3], y[3];
+  bool shown[3];
+  TTVout tv;
+  for (int m = 0; m < 2; m++) {
+    tv.begin(m ? SC_224x216 | SC_DMA16 : SC_224x216, 1, vram);
+    for (int i = 0; i < (int)sizeof(vram); i++)
+      vram[i] = rnd(256);
+    screen_dots(tv, dots_c);
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3*20; j++) {
+        image[i][j] = rnd(256);
+        mask[i][j] = rnd(256) | rnd(256);
+      }
+      tv.add_sprite(&s[i], image[i], i == 1 ? NULL : mask[i], sw[i], sh[i], save[i]);
+      shown[i] = false;
+    }
+    for (int k = 0; k < 60; k++) {
+      int i = rnd(3);
+      if (rnd(5)) {
+        x[i] = k & 1 ? rnd(40) + 60 : rnd(260) - 30;   // mostly over each other
+        y[i] = k & 1 ? rnd(40) + 60 : rnd(250) - 30;
+        tv.move_sprite(&s[i], x[i], y[i]);
+        shown[i] = true;
+      } else {
+        tv.hide_sprite(&s[i]);
+        shown[i] = false;
+      }
+      memcpy(dots_b, dots_c, 224*216);
+      for (int j = 0; j < 3; j++)
+        if (shown[j])
+          ref_sprite(dots_b, image[j], j == 1 ? NULL : mask[j], sw[j], sh[j], x[j], y[j]);
+      screen_dots(tv, dots_a);
+      CHECK(memcmp(dots_a, dots_b, 224*216) == 0);
+    }
+    tv.remove_sprite(&s[1]);
+    tv.remove_sprite(&s[0]);
+    tv.remove_sprite(&s[2]);
+    screen_dots(tv, dots_a);
+    CHECK(memcmp(dots_a, dots_c, 224*216) == 0);
+  }
+}
+
+int main() {
+  test_gray();
+  test_dma16();
+  test_rect();
+  test_line_end();
+  test_shift();
+  test_glyph_cache();
+  test_print();
+  test_polygon();
+  test_curves();
+  test_stroke();
+  test_pattern_rect();
+  test_flood_fill();
+  test_scaled();
+  test_surface();
+  test_sprites();
+  printf("%s (%d failed)\n", fails ? "FAILED" : "ok", fails);
+  return fails;
+}